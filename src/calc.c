@@ -9,6 +9,7 @@
 
 #include <stdlib.h>
 #include "memory.h"
+#include "poly.h"
 #include "reader.h"
 #include "input_handler.h"
 #include "stack.h"
@@ -23,11 +24,38 @@
 
 #define INI_VERSE_SIZE (1 << 8) ///< początkowy rozmiar linii
 
+/** Nazwa zmiennej środowiskowej włączającej współdzielenie wielomianów. */
+#define SHARING_ENV_VARIABLE "POLY_SHARING"
+
+/** Nazwa zmiennej środowiskowej włączającej internowanie wielomianów. */
+#define INTERN_ENV_VARIABLE "POLY_INTERN"
+
+/** Nazwa zmiennej środowiskowej włączającej wykrywanie przepełnień. */
+#define OVERFLOW_ENV_VARIABLE "POLY_CHECK_OVERFLOW"
+
+/** Nazwa zmiennej środowiskowej z budżetem pamięci podręcznej potęg. */
+#define POWER_CACHE_ENV_VARIABLE "POLY_POWER_CACHE"
+
 /**
  * Funkcja main programu.
  * @return kod zakończenia programu
  * */
 int main(void) {
+    PolySetThreads(0);
+
+    const char *sharing = getenv(SHARING_ENV_VARIABLE);
+    PolySetSharing(sharing != NULL && *sharing != '\0' && *sharing != '0');
+
+    const char *intern = getenv(INTERN_ENV_VARIABLE);
+    PolySetInterning(intern != NULL && *intern != '\0' && *intern != '0');
+
+    const char *overflow = getenv(OVERFLOW_ENV_VARIABLE);
+    PolySetOverflowCheck(overflow != NULL && *overflow != '\0'
+                         && *overflow != '0');
+
+    const char *budget = getenv(POWER_CACHE_ENV_VARIABLE);
+    PolySetPowerCacheBudget(budget == NULL ? DEFAULT_POWER_CACHE_BUDGET
+                                           : strtoul(budget, NULL, 10));
 
     Stack stack = createEmptyStack();
 
@@ -46,10 +74,15 @@ int main(void) {
             handleCommand(line, lineNumber, &stack);
         else
             handlePoly(line, lineNumber, &stack);
+
+        if (PolyClearOverflow())
+            printError(lineNumber, "OVERFLOW");
     }
 
     safeFree((void **) &line);
     destoryStack(&stack);
+    PolySetPowerCacheBudget(0);
+    PolySetThreads(1);
 
     return 0;
 }
\ No newline at end of file
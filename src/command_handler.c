@@ -10,6 +10,7 @@
 #include "command_handler.h"
 #include "input_handler.h"
 #include "parser.h"
+#include "poly_program.h"
 
 /**
  * Sprawdzenie czy stos zawiera odpowiednią liczbę elementów.
@@ -135,7 +136,9 @@ void handleIsEq(__attribute__((unused)) char *const str,
     Poly a = topStack(stack);
     Poly b = secondTopStack(stack);
 
-    printf("%d\n", PolyIsEq(&a, &b) ? 1 : 0);
+    bool isEq = topStackHash(stack) == secondTopStackHash(stack)
+                && PolyIsEq(&a, &b);
+    printf("%d\n", isEq ? 1 : 0);
 }
 
 void handleDeg(__attribute__((unused)) char *const str,
@@ -198,6 +201,117 @@ void handleAt(char *const str,
     pushStack(stack, at);
 }
 
+void handleAtMany(char *const str,
+                  size_t lineNumber,
+                  Stack *stack) {
+    char *name = "AT_MANY";
+    char *spaceAndArguments = ((char *) str) + strlen(name);
+    size_t count;
+    poly_coeff_t *arguments;
+
+    if (*spaceAndArguments != ' ' ||
+        !canBeCoeffList(spaceAndArguments + 1, &count, &arguments)) {
+        printError(lineNumber, "AT_MANY WRONG VALUE");
+        return;
+    }
+
+    if (!stackHasXPolys(lineNumber, stack, 1)) {
+        safeFree((void **) &arguments);
+        return;
+    }
+
+    Poly a = takeStack(stack);
+    Poly *results = safeCalloc(count, sizeof(Poly));
+    PolyAtMany(&a, count, arguments, results);
+
+    PolyDestroy(&a);
+
+    for (size_t i = 0; i < count; ++i)
+        pushStack(stack, results[i]);
+
+    safeFree((void **) &results);
+    safeFree((void **) &arguments);
+}
+
+void handleEval(char *const str,
+                size_t lineNumber,
+                Stack *stack) {
+    char *name = "EVAL";
+    char *spaceAndArguments = ((char *) str) + strlen(name);
+    size_t count;
+    poly_coeff_t *arguments;
+
+    if (*spaceAndArguments != ' ' ||
+        !canBeCoeffList(spaceAndArguments + 1, &count, &arguments)) {
+        printError(lineNumber, "EVAL WRONG VALUE");
+        return;
+    }
+
+    if (!stackHasXPolys(lineNumber, stack, 1)) {
+        safeFree((void **) &arguments);
+        return;
+    }
+
+    Poly a = takeStack(stack);
+    poly_coeff_t value = PolyEvalPoint(&a, count, arguments);
+
+    PolyDestroy(&a);
+    safeFree((void **) &arguments);
+
+    pushStack(stack, PolyFromCoeff(value));
+}
+
+void handleEvalMany(char *const str,
+                    size_t lineNumber,
+                    Stack *stack) {
+    char *name = "EVAL_MANY";
+    char *spaceAndArguments = ((char *) str) + strlen(name);
+    size_t count;
+    poly_coeff_t *arguments;
+
+    if (*spaceAndArguments != ' ' ||
+        !canBeCoeffList(spaceAndArguments + 1, &count, &arguments)) {
+        printError(lineNumber, "EVAL_MANY WRONG VALUE");
+        return;
+    }
+
+    if (arguments[0] <= 0 || count == 1 ||
+        (count - 1) % (size_t) arguments[0] != 0) {
+        printError(lineNumber, "EVAL_MANY WRONG VALUE");
+        safeFree((void **) &arguments);
+        return;
+    }
+
+    if (!stackHasXPolys(lineNumber, stack, 1)) {
+        safeFree((void **) &arguments);
+        return;
+    }
+
+    size_t k = (size_t) arguments[0];
+    size_t n = (count - 1) / k;
+    Poly a = takeStack(stack);
+    poly_coeff_t *values = safeCalloc(n, sizeof(poly_coeff_t));
+
+    // Program liczy wektorowo i nie wykrywa przepełnień.
+    if (PolyOverflowCheckEnabled()) {
+        for (size_t i = 0; i < n; ++i)
+            values[i] = PolyEvalPoint(&a, k, arguments + 1 + i * k);
+    }
+    else {
+        PolyProgram program = programCompile(&a);
+        programEval(&program, k, n, arguments + 1, values);
+        programDestroy(&program);
+    }
+
+    PolyDestroy(&a);
+
+    for (size_t i = 0; i < n; ++i)
+        pushStack(stack, PolyFromCoeff(values[i]));
+
+    safeFree((void **) &values);
+    safeFree((void **) &arguments);
+}
+
 void handlePrint(__attribute__((unused)) char *const str,
                  size_t lineNumber,
                  Stack *stack) {
@@ -218,6 +332,32 @@ void handlePop(__attribute__((unused)) char *const str,
     popStack(stack);
 }
 
+void handlePow(char *const str,
+               size_t lineNumber,
+               Stack *stack) {
+    char *name = "POW";
+    char *spaceAndArgument = (char *) str + strlen(name);
+    poly_exp_t argument;
+    char *endPtr;
+
+    if (*spaceAndArgument != ' ' ||
+        !canBePow(spaceAndArgument + 1, &argument, &endPtr) ||
+        *endPtr != '\0') {
+        printError(lineNumber, "POW WRONG VALUE");
+        return;
+    }
+
+    if (!stackHasXPolys(lineNumber, stack, 1))
+        return;
+
+    Poly a = takeStack(stack);
+    Poly res = PolyPow(&a, argument);
+
+    PolyDestroy(&a);
+
+    pushStack(stack, res);
+}
+
 void handleCompose(char *const str,
                    size_t lineNumber,
                    Stack *stack) {
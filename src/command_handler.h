@@ -8,12 +8,16 @@
  * - CLONE – wstawia na stos kopię wielomianu z wierzchołka;
  * - ADD – dodaje dwa wielomiany z wierzchu stosu, usuwa je i wstawia na wierzchołek stosu ich sumę;
  * - MUL – mnoży dwa wielomiany z wierzchu stosu, usuwa je i wstawia na wierzchołek stosu ich iloczyn;
+ * - POW n – podnosi wielomian z wierzchołka stosu do potęgi n, usuwa go i wstawia na stos wynik operacji;
  * - NEG – neguje wielomian na wierzchołku stosu;
  * - SUB – odejmuje od wielomianu z wierzchołka wielomian pod wierzchołkiem, usuwa je i wstawia na wierzchołek stosu różnicę;
  * - IS_EQ – sprawdza, czy dwa wielomiany na wierzchu stosu są równe – wypisuje na standardowe wyjście 0 lub 1;
  * - DEG – wypisuje na standardowe wyjście stopień wielomianu (−1 dla wielomianu tożsamościowo równego zeru);
  * - DEG_BY idx – wypisuje na standardowe wyjście stopień wielomianu ze względu na zmienną o numerze idx (−1 dla wielomianu tożsamościowo równego zeru);
  * - AT x – wylicza wartość wielomianu w punkcie x, usuwa wielomian z wierzchołka i wstawia na stos wynik operacji;
+ * - EVAL x0 ... xk – wylicza wartość wielomianu, podstawiając x0, ..., xk pod kolejne zmienne i 0 pod pozostałe, usuwa wielomian z wierzchołka i wstawia na stos wynik operacji;
+ * - EVAL_MANY k x1 ... xn – dzieli x1, ..., xn na kolejne punkty o k współrzędnych, wylicza wartość wielomianu w każdym z nich jak EVAL, usuwa wielomian z wierzchołka i wstawia na stos kolejno wyniki;
+ * - AT_MANY x1 ... xn – wylicza wartości wielomianu w punktach x1, ..., xn, usuwa wielomian z wierzchołka i wstawia na stos kolejno wyniki dla x1, ..., xn;
  * - PRINT – wypisuje na standardowe wyjście wielomian z wierzchołka stosu;
  * - POP – usuwa wielomian z wierzchołka stosu.
  *
@@ -123,6 +127,30 @@ void handleDegBy(char *str, size_t lineNumber, Stack *stack);
  * */
 void handleAt(char *str, size_t lineNumber, Stack *stack);
 
+/**
+ * Obsługa komendy AT_MANY.
+ * @param[in] str : komenda wprowadzona przez użytkownika
+ * @param[in] lineNumber : numer linii
+ * @param[in,out] stack : stos kalkulatora
+ * */
+void handleAtMany(char *str, size_t lineNumber, Stack *stack);
+
+/**
+ * Obsługa komendy EVAL.
+ * @param[in] str : komenda wprowadzona przez użytkownika
+ * @param[in] lineNumber : numer linii
+ * @param[in,out] stack : stos kalkulatora
+ * */
+void handleEval(char *str, size_t lineNumber, Stack *stack);
+
+/**
+ * Obsługa komendy EVAL_MANY.
+ * @param[in] str : komenda wprowadzona przez użytkownika
+ * @param[in] lineNumber : numer linii
+ * @param[in,out] stack : stos kalkulatora
+ * */
+void handleEvalMany(char *str, size_t lineNumber, Stack *stack);
+
 /**
  * Obsługa komendy PRINT.
  * @param[in] str : komenda wprowadzona przez użytkownika
@@ -139,6 +167,14 @@ void handlePrint(__attribute__((unused)) char *str, size_t lineNumber, Stack *st
  * */
 void handlePop(__attribute__((unused)) char *str, size_t lineNumber, Stack *stack);
 
+/**
+ * Obsługa komendy POW.
+ * @param[in] str : komenda wprowadzona przez użytkownika
+ * @param[in] lineNumber : numer linii
+ * @param[in,out] stack : stos kalkulatora
+ * */
+void handlePow(char *str, size_t lineNumber, Stack *stack);
+
 /**
  * Obsługa komendy COMPOSE.
  * @param[in] str : komenda wprowadzona przez użytkownika
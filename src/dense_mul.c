@@ -0,0 +1,542 @@
+/** @file
+ * Implementacja modułu mnożenia gęstych wektorów współczynników.
+ *
+ * Obliczenia prowadzone są na typie unsigned long, na którym przekręcenie
+ * się jest dobrze zdefiniowane i zgodne z reprezentacją poly_coeff_t.
+ * Algorytm Karatsuby używa jedynie dodawania, odejmowania i mnożenia,
+ * więc jego wynik modulo @f$2^{64}@f$ jest równy wynikowi mnożenia szkolnego.
+ *
+ * Najdłuższe wektory mnożone są szybką transformatą teoretycznoliczbową
+ * (NTT) modulo trzech liczb pierwszych mniejszych niż @f$2^{62}@f$.
+ * Iloczyn ich wynosi około @f$2^{186}@f$, a wartość bezwzględna
+ * współczynnika dokładnego iloczynu jest mniejsza niż @f$2^{126+40}@f$,
+ * więc chińskie twierdzenie o resztach odtwarza dokładną wartość
+ * współczynnika, a z niej wynik modulo @f$2^{64}@f$.
+ * */
+
+#include <stdint.h>
+#include <string.h>
+#include "dense_mul.h"
+#include "memory.h"
+
+/** Typ, na którym wykonywane są obliczenia modulo @f$2^{64}@f$. */
+typedef unsigned long ucoeff_t;
+
+/** Typ iloczynów pośrednich w arytmetyce modularnej. */
+typedef unsigned __int128 uwide_t;
+
+/** Próg przejścia z mnożenia szkolnego na algorytm Karatsuby. */
+static size_t karatsubaThreshold = DEFAULT_KARATSUBA_THRESHOLD;
+
+/** Próg przejścia z algorytmu Karatsuby na mnożenie transformatą. */
+static size_t nttThreshold = DEFAULT_NTT_THRESHOLD;
+
+/** Liczba liczb pierwszych używanych przez transformatę. */
+#define NTT_PRIMES 3
+
+/** Logarytm największej długości transformaty. */
+#define NTT_MAX_LOG 40
+
+/**
+ * Liczba pierwsza postaci @f$k\cdot 2^{40} + 1@f$ wraz ze stałymi
+ * arytmetyki Montgomery'ego dla @f$R = 2^{64}@f$.
+ * */
+typedef struct {
+    uint64_t mod; ///< liczba pierwsza @f$p@f$
+    uint64_t generator; ///< generator grupy multiplikatywnej modulo @f$p@f$
+    uint64_t negInv; ///< @f$-p^{-1} \bmod R@f$
+    uint64_t r2; ///< @f$R^2 \bmod p@f$
+} NttPrime;
+
+/** Liczby pierwsze transformaty, malejąco. */
+static const uint64_t NTT_MODS[NTT_PRIMES] = {
+        4611615649683210241UL, 4611613450659954689UL, 4611549678985543681UL
+};
+
+/** Generatory grup multiplikatywnych modulo liczby pierwsze transformaty. */
+static const uint64_t NTT_GENERATORS[NTT_PRIMES] = {11, 3, 19};
+
+/**
+ * Mnożenie szkolne dwóch wektorów z dodaniem wyniku do @p out.
+ * @param[in] a : pierwszy czynnik
+ * @param[in] n : długość @p a
+ * @param[in] b : drugi czynnik
+ * @param[in] m : długość @p b
+ * @param[in,out] out : wektor długości @f$n + m - 1@f$
+ * */
+static void schoolbookAddMul(const ucoeff_t *a, size_t n,
+                             const ucoeff_t *b, size_t m,
+                             ucoeff_t *out) {
+    for (size_t i = 0; i < n; ++i) {
+        if (a[i] == 0)
+            continue;
+
+        for (size_t j = 0; j < m; ++j)
+            out[i + j] += a[i] * b[j];
+    }
+}
+
+/**
+ * Podnoszenie wektora do kwadratu metodą szkolną z dodaniem wyniku do @p out.
+ * Każdy iloczyn różnych współczynników wyliczany jest raz i podwajany.
+ * @param[in] a : podnoszony wektor
+ * @param[in] n : długość @p a
+ * @param[in,out] out : wektor długości @f$2n - 1@f$
+ * */
+static void schoolbookAddSquare(const ucoeff_t *a, size_t n, ucoeff_t *out) {
+    for (size_t i = 0; i < n; ++i) {
+        if (a[i] == 0)
+            continue;
+
+        ucoeff_t twice = 2 * a[i];
+        out[2 * i] += a[i] * a[i];
+        for (size_t j = i + 1; j < n; ++j)
+            out[i + j] += twice * a[j];
+    }
+}
+
+/**
+ * Algorytm Karatsuby dla wektorów równej długości.
+ * @param[in] a : pierwszy czynnik
+ * @param[in] b : drugi czynnik
+ * @param[in] n : długość obu czynników
+ * @param[out] out : wektor długości @f$2n - 1@f$ na iloczyn
+ * @param[in] scratch : pamięć pomocnicza, co najmniej @f$4n + 256@f$ elementów
+ * */
+static void karatsuba(const ucoeff_t *a, const ucoeff_t *b, size_t n,
+                      ucoeff_t *out, ucoeff_t *scratch) {
+    if (n < karatsubaThreshold) {
+        memset(out, 0, (2 * n - 1) * sizeof(ucoeff_t));
+        schoolbookAddMul(a, n, b, n, out);
+        return;
+    }
+
+    size_t lo = n / 2;
+    size_t hi = n - lo;
+
+    // a = a0 + x^lo a1, b = b0 + x^lo b1; z0 = a0 b0, z2 = a1 b1
+    karatsuba(a, b, lo, out, scratch);
+    out[2 * lo - 1] = 0;
+    karatsuba(a + lo, b + lo, hi, out + 2 * lo, scratch);
+
+    ucoeff_t *sumA = scratch;
+    ucoeff_t *sumB = sumA + hi;
+    ucoeff_t *mid = sumB + hi;
+    ucoeff_t *rest = mid + 2 * hi - 1;
+
+    for (size_t i = 0; i < hi; ++i) {
+        sumA[i] = a[lo + i] + (i < lo ? a[i] : 0);
+        sumB[i] = b[lo + i] + (i < lo ? b[i] : 0);
+    }
+
+    // z1 = (a0 + a1)(b0 + b1) - z0 - z2
+    karatsuba(sumA, sumB, hi, mid, rest);
+
+    for (size_t i = 0; i < 2 * lo - 1; ++i)
+        mid[i] -= out[i];
+    for (size_t i = 0; i < 2 * hi - 1; ++i)
+        mid[i] -= out[2 * lo + i];
+
+    for (size_t i = 0; i < 2 * hi - 1; ++i)
+        out[lo + i] += mid[i];
+}
+
+/**
+ * Algorytm Karatsuby podnoszący wektor do kwadratu.
+ * Wszystkie trzy iloczyny połówek są kwadratami, więc rekurencja
+ * schodzi do schoolbookAddSquare().
+ * @param[in] a : podnoszony wektor
+ * @param[in] n : długość @p a
+ * @param[out] out : wektor długości @f$2n - 1@f$ na kwadrat
+ * @param[in] scratch : pamięć pomocnicza, co najmniej @f$4n + 256@f$ elementów
+ * */
+static void karatsubaSquare(const ucoeff_t *a, size_t n,
+                            ucoeff_t *out, ucoeff_t *scratch) {
+    if (n < karatsubaThreshold) {
+        memset(out, 0, (2 * n - 1) * sizeof(ucoeff_t));
+        schoolbookAddSquare(a, n, out);
+        return;
+    }
+
+    size_t lo = n / 2;
+    size_t hi = n - lo;
+
+    // a = a0 + x^lo a1; z0 = a0^2, z2 = a1^2
+    karatsubaSquare(a, lo, out, scratch);
+    out[2 * lo - 1] = 0;
+    karatsubaSquare(a + lo, hi, out + 2 * lo, scratch);
+
+    ucoeff_t *sum = scratch;
+    ucoeff_t *mid = sum + hi;
+    ucoeff_t *rest = mid + 2 * hi - 1;
+
+    for (size_t i = 0; i < hi; ++i)
+        sum[i] = a[lo + i] + (i < lo ? a[i] : 0);
+
+    // z1 = (a0 + a1)^2 - z0 - z2
+    karatsubaSquare(sum, hi, mid, rest);
+
+    for (size_t i = 0; i < 2 * lo - 1; ++i)
+        mid[i] -= out[i];
+    for (size_t i = 0; i < 2 * hi - 1; ++i)
+        mid[i] -= out[2 * lo + i];
+
+    for (size_t i = 0; i < 2 * hi - 1; ++i)
+        out[lo + i] += mid[i];
+}
+
+/**
+ * Potęgowanie modulo @p mod.
+ * @param[in] a : podstawa
+ * @param[in] e : wykładnik
+ * @param[in] mod : moduł
+ * @return @f$a^e \bmod mod@f$
+ * */
+static uint64_t powMod(uint64_t a, uint64_t e, uint64_t mod) {
+    uint64_t res = 1;
+    a %= mod;
+
+    while (e > 0) {
+        if (e & 1)
+            res = (uint64_t) ((uwide_t) res * a % mod);
+        a = (uint64_t) ((uwide_t) a * a % mod);
+        e >>= 1;
+    }
+
+    return res;
+}
+
+/**
+ * Wyznaczenie stałych arytmetyki Montgomery'ego dla liczby pierwszej.
+ * @param[in] mod : liczba pierwsza
+ * @param[in] generator : generator grupy multiplikatywnej
+ * @return liczba pierwsza wraz ze stałymi
+ * */
+static NttPrime nttPrimeInit(uint64_t mod, uint64_t generator) {
+    // Metoda Newtona: każdy krok podwaja liczbę poprawnych bitów odwrotności.
+    uint64_t inv = mod;
+    for (int i = 0; i < 6; ++i)
+        inv *= 2 - mod * inv;
+
+    uint64_t r = (uint64_t) (((uwide_t) 1 << 64) % mod);
+
+    return (NttPrime) {.mod = mod,
+                       .generator = generator,
+                       .negInv = -inv,
+                       .r2 = (uint64_t) ((uwide_t) r * r % mod)};
+}
+
+/**
+ * Mnożenie Montgomery'ego.
+ * @param[in] a : czynnik mniejszy niż @f$p@f$
+ * @param[in] b : czynnik mniejszy niż @f$p@f$
+ * @param[in] pr : liczba pierwsza
+ * @return @f$a\cdot b\cdot R^{-1} \bmod p@f$
+ * */
+static inline uint64_t montMul(uint64_t a, uint64_t b, const NttPrime *pr) {
+    uwide_t t = (uwide_t) a * b;
+    uint64_t m = (uint64_t) t * pr->negInv;
+    uint64_t u = (uint64_t) ((t + (uwide_t) m * pr->mod) >> 64);
+
+    return u >= pr->mod ? u - pr->mod : u;
+}
+
+/**
+ * Zamiana liczby na postać Montgomery'ego.
+ * @param[in] a : liczba mniejsza niż @f$p@f$
+ * @param[in] pr : liczba pierwsza
+ * @return @f$a\cdot R \bmod p@f$
+ * */
+static inline uint64_t toMont(uint64_t a, const NttPrime *pr) {
+    return montMul(a, pr->r2, pr);
+}
+
+/**
+ * Tablica czynników obrotu w postaci Montgomery'ego.
+ * @param[in] len : długość transformaty, potęga dwójki
+ * @param[in] pr : liczba pierwsza
+ * @param[in] inverse : czy tablica dla transformaty odwrotnej
+ * @return tablica @f$w^j@f$ dla @f$j < len/2@f$, gdzie @f$w@f$ to
+ * pierwiastek pierwotny stopnia @p len z jedynki (lub jego odwrotność)
+ * */
+static uint64_t *nttTwiddles(size_t len, const NttPrime *pr, bool inverse) {
+    uint64_t root = powMod(pr->generator, (pr->mod - 1) / len, pr->mod);
+    if (inverse)
+        root = powMod(root, pr->mod - 2, pr->mod);
+
+    uint64_t rootMont = toMont(root, pr);
+    uint64_t *twiddles = safeCalloc(len / 2 + 1, sizeof(uint64_t));
+
+    twiddles[0] = toMont(1, pr);
+    for (size_t j = 1; j < len / 2; ++j)
+        twiddles[j] = montMul(twiddles[j - 1], rootMont, pr);
+
+    return twiddles;
+}
+
+/**
+ * Transformata teoretycznoliczbowa w miejscu.
+ * Wartości wektora są w postaci zwykłej, a czynniki obrotu w postaci
+ * Montgomery'ego, więc ich iloczyny są w postaci zwykłej.
+ * @param[in,out] a : przekształcany wektor
+ * @param[in] len : długość wektora, potęga dwójki
+ * @param[in] twiddles : tablica czynników obrotu z nttTwiddles()
+ * @param[in] pr : liczba pierwsza
+ * */
+static void ntt(uint64_t *a, size_t len, const uint64_t *twiddles,
+                const NttPrime *pr) {
+    uint64_t mod = pr->mod;
+
+    for (size_t i = 1, j = 0; i < len; ++i) {
+        size_t bit = len >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+
+        if (i < j) {
+            uint64_t tmp = a[i];
+            a[i] = a[j];
+            a[j] = tmp;
+        }
+    }
+
+    for (size_t half = 1; half < len; half <<= 1) {
+        size_t stride = len / (2 * half);
+
+        for (size_t i = 0; i < len; i += 2 * half) {
+            for (size_t j = 0; j < half; ++j) {
+                uint64_t u = a[i + j];
+                uint64_t v = montMul(a[i + j + half], twiddles[j * stride], pr);
+
+                a[i + j] = u + v >= mod ? u + v - mod : u + v;
+                a[i + j + half] = u >= v ? u - v : u + mod - v;
+            }
+        }
+    }
+}
+
+/**
+ * Reszta z dzielenia współczynnika przez liczbę pierwszą transformaty.
+ * Wartość bezwzględna współczynnika jest mniejsza niż @f$3p@f$.
+ * @param[in] c : współczynnik
+ * @param[in] mod : liczba pierwsza
+ * @return @f$c \bmod p@f$ w przedziale @f$[0, p)@f$
+ * */
+static inline uint64_t reduceCoeff(poly_coeff_t c, uint64_t mod) {
+    uint64_t abs = c < 0 ? -(uint64_t) c : (uint64_t) c;
+    while (abs >= mod)
+        abs -= mod;
+
+    return (c < 0 && abs != 0) ? mod - abs : abs;
+}
+
+/**
+ * Iloczyn wektorów modulo liczba pierwsza wyznaczony transformatą.
+ * @param[in] a : pierwszy czynnik
+ * @param[in] n : długość @p a
+ * @param[in] b : drugi czynnik
+ * @param[in] m : długość @p b
+ * @param[in] len : długość transformaty, potęga dwójki co najmniej
+ * @f$n + m - 1@f$
+ * @param[in] pr : liczba pierwsza
+ * @return wektor długości @p len z resztami współczynników iloczynu
+ * */
+static uint64_t *nttMulMod(const poly_coeff_t *a, size_t n,
+                           const poly_coeff_t *b, size_t m,
+                           size_t len, const NttPrime *pr) {
+    // Kwadrat wymaga tylko jednej transformaty w przód.
+    bool square = a == b && n == m;
+    uint64_t *fa = safeCalloc(len, sizeof(uint64_t));
+    uint64_t *fb = square ? fa : safeCalloc(len, sizeof(uint64_t));
+
+    for (size_t i = 0; i < n; ++i)
+        fa[i] = reduceCoeff(a[i], pr->mod);
+    for (size_t i = 0; i < m && !square; ++i)
+        fb[i] = reduceCoeff(b[i], pr->mod);
+
+    uint64_t *twiddles = nttTwiddles(len, pr, false);
+    ntt(fa, len, twiddles, pr);
+    if (!square)
+        ntt(fb, len, twiddles, pr);
+    safeFree((void **) &twiddles);
+
+    for (size_t i = 0; i < len; ++i)
+        fa[i] = montMul(fa[i], fb[i], pr);
+
+    twiddles = nttTwiddles(len, pr, true);
+    ntt(fa, len, twiddles, pr);
+    safeFree((void **) &twiddles);
+
+    // Iloczyn punktowy dał czynnik R^{-1}, a transformata odwrotna czynnik len.
+    uint64_t scale = powMod(len % pr->mod, pr->mod - 2, pr->mod);
+    uint64_t scaleMont = toMont(toMont(scale, pr), pr);
+    for (size_t i = 0; i < len; ++i)
+        fa[i] = montMul(fa[i], scaleMont, pr);
+
+    if (!square)
+        safeFree((void **) &fb);
+    return fa;
+}
+
+/**
+ * Mnożenie dwóch wektorów transformatą teoretycznoliczbową.
+ * Iloczyn wyznaczany jest modulo trzy liczby pierwsze, a współczynniki
+ * odtwarzane algorytmem Garnera. Dokładna wartość współczynnika leży
+ * w przedziale @f$(-M/2, M/2)@f$, gdzie @f$M@f$ to iloczyn liczb pierwszych.
+ * @param[in] a : pierwszy czynnik
+ * @param[in] n : długość @p a
+ * @param[in] b : drugi czynnik
+ * @param[in] m : długość @p b
+ * @param[out] out : wektor długości @f$n + m - 1@f$ na iloczyn
+ * @return czy któryś dokładny współczynnik nie mieści się w poly_coeff_t
+ * */
+static bool nttMul(const poly_coeff_t *a, size_t n,
+                   const poly_coeff_t *b, size_t m,
+                   poly_coeff_t *out) {
+    size_t len = 1;
+    while (len < n + m - 1)
+        len <<= 1;
+    assert(len <= ((size_t) 1 << NTT_MAX_LOG));
+
+    NttPrime pr[NTT_PRIMES];
+    uint64_t *res[NTT_PRIMES];
+    for (size_t k = 0; k < NTT_PRIMES; ++k) {
+        pr[k] = nttPrimeInit(NTT_MODS[k], NTT_GENERATORS[k]);
+        res[k] = nttMulMod(a, n, b, m, len, &pr[k]);
+    }
+
+    uint64_t p0 = pr[0].mod, p1 = pr[1].mod, p2 = pr[2].mod;
+    // Odwrotności w postaci Montgomery'ego: p0^{-1} mod p1, (p0 p1)^{-1} mod p2.
+    uint64_t inv01 = toMont(powMod(p0, p1 - 2, p1), &pr[1]);
+    uint64_t p0p1ModP2 = (uint64_t) ((uwide_t) p0 * p1 % p2);
+    uint64_t inv012 = toMont(powMod(p0p1ModP2, p2 - 2, p2), &pr[2]);
+    uint64_t p0Mont2 = toMont(p0 % p2, &pr[2]);
+
+    uwide_t p0p1 = (uwide_t) p0 * p1;
+    uint64_t halfP2 = (p2 - 1) / 2;
+    uwide_t halfP0P1 = (p0p1 - 1) / 2;
+    // M mod 2^64
+    uint64_t mLow = (uint64_t) p0p1 * p2;
+    // Moduł najmniejszej wartości poly_coeff_t.
+    uwide_t minAbs = (uwide_t) 1 << 63;
+    bool overflow = false;
+
+    for (size_t i = 0; i < n + m - 1; ++i) {
+        uint64_t r0 = res[0][i], r1 = res[1][i], r2 = res[2][i];
+
+        uint64_t r0Mod1 = r0 % p1;
+        uint64_t diff1 = r1 >= r0Mod1 ? r1 - r0Mod1 : r1 + p1 - r0Mod1;
+        uint64_t t1 = montMul(diff1, inv01, &pr[1]);
+
+        uint64_t low2 = r0 % p2 + montMul(t1, p0Mont2, &pr[2]);
+        low2 = low2 >= p2 ? low2 - p2 : low2;
+        uint64_t diff2 = r2 >= low2 ? r2 - low2 : r2 + p2 - low2;
+        uint64_t t2 = montMul(diff2, inv012, &pr[2]);
+
+        // x = r0 + p0 t1 + p0 p1 t2, gdzie r0 + p0 t1 < p0 p1
+        uwide_t rest = r0 + (uwide_t) p0 * t1;
+        uint64_t x = (uint64_t) rest + (uint64_t) p0p1 * t2;
+        bool negative = t2 > halfP2 || (t2 == halfP2 && rest > halfP0P1);
+
+        // Wartość mieści się, gdy jest równa x < 2^63 lub x - M >= -2^63.
+        overflow |= (t2 != 0 || rest >= minAbs)
+                    && (t2 != p2 - 1 || p0p1 - rest > minAbs);
+
+        out[i] = (poly_coeff_t) (negative ? x - mLow : x);
+    }
+
+    for (size_t k = 0; k < NTT_PRIMES; ++k)
+        safeFree((void **) &res[k]);
+
+    return overflow;
+}
+
+void denseMul(const poly_coeff_t *a, size_t n,
+              const poly_coeff_t *b, size_t m,
+              poly_coeff_t *out) {
+    assert(n > 0 && m > 0);
+
+    // Dłuższy czynnik dzielony jest na kawałki długości krótszego.
+    const ucoeff_t *longer = (const ucoeff_t *) (n >= m ? a : b);
+    const ucoeff_t *shorter = (const ucoeff_t *) (n >= m ? b : a);
+    size_t longLen = n >= m ? n : m;
+    size_t shortLen = n >= m ? m : n;
+    ucoeff_t *res = (ucoeff_t *) out;
+
+    if (shortLen >= nttThreshold) {
+        nttMul(a, n, b, m, out);
+        return;
+    }
+
+    memset(res, 0, (n + m - 1) * sizeof(ucoeff_t));
+
+    if (shortLen < karatsubaThreshold) {
+        schoolbookAddMul(longer, longLen, shorter, shortLen, res);
+        return;
+    }
+
+    ucoeff_t *chunk = safeCalloc(shortLen, sizeof(ucoeff_t));
+    ucoeff_t *prod = safeCalloc(2 * shortLen - 1, sizeof(ucoeff_t));
+    ucoeff_t *scratch = safeCalloc(4 * shortLen + 256, sizeof(ucoeff_t));
+
+    for (size_t start = 0; start < longLen; start += shortLen) {
+        size_t len = longLen - start < shortLen ? longLen - start : shortLen;
+        memset(chunk, 0, shortLen * sizeof(ucoeff_t));
+        memcpy(chunk, longer + start, len * sizeof(ucoeff_t));
+
+        karatsuba(chunk, shorter, shortLen, prod, scratch);
+
+        size_t prodLen = len + shortLen - 1;
+        for (size_t i = 0; i < prodLen; ++i)
+            res[start + i] += prod[i];
+    }
+
+    safeFree((void **) &chunk);
+    safeFree((void **) &prod);
+    safeFree((void **) &scratch);
+}
+
+bool denseMulChecked(const poly_coeff_t *a, size_t n,
+                     const poly_coeff_t *b, size_t m,
+                     poly_coeff_t *out) {
+    assert(n > 0 && m > 0);
+    return nttMul(a, n, b, m, out);
+}
+
+void denseSquare(const poly_coeff_t *a, size_t n, poly_coeff_t *out) {
+    assert(n > 0);
+
+    if (n >= nttThreshold) {
+        nttMul(a, n, a, n, out);
+        return;
+    }
+
+    const ucoeff_t *vec = (const ucoeff_t *) a;
+    ucoeff_t *res = (ucoeff_t *) out;
+
+    if (n < karatsubaThreshold) {
+        memset(res, 0, (2 * n - 1) * sizeof(ucoeff_t));
+        schoolbookAddSquare(vec, n, res);
+        return;
+    }
+
+    ucoeff_t *scratch = safeCalloc(4 * n + 256, sizeof(ucoeff_t));
+    karatsubaSquare(vec, n, res, scratch);
+    safeFree((void **) &scratch);
+}
+
+void setKaratsubaThreshold(size_t threshold) {
+    karatsubaThreshold = threshold < 2 ? 2 : threshold;
+}
+
+size_t getKaratsubaThreshold(void) {
+    return karatsubaThreshold;
+}
+
+void setNttThreshold(size_t threshold) {
+    nttThreshold = threshold < 1 ? 1 : threshold;
+}
+
+size_t getNttThreshold(void) {
+    return nttThreshold;
+}
@@ -0,0 +1,95 @@
+/** @file
+ * Interfejs modułu mnożenia gęstych wektorów współczynników.
+ *
+ * Wektory współczynników indeksowane są wykładnikami rosnąco. Wszystkie
+ * obliczenia wykonywane są modulo @f$2^{64}@f$, więc wynik jest identyczny
+ * z wynikiem mnożenia szkolnego na przekręcającym się typie poly_coeff_t.
+ * */
+
+#ifndef DENSE_MUL_H
+#define DENSE_MUL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "poly.h"
+
+/** Domyślny próg przejścia z mnożenia szkolnego na algorytm Karatsuby. */
+#define DEFAULT_KARATSUBA_THRESHOLD 32
+
+/** Domyślny próg przejścia z algorytmu Karatsuby na transformatę NTT. */
+#define DEFAULT_NTT_THRESHOLD 8192
+
+/**
+ * Mnożenie dwóch gęstych wektorów współczynników.
+ * Jeśli krótszy wektor ma długość co najmniej progu transformaty, wektory
+ * mnożone są transformatą teoretycznoliczbową. W przeciwnym razie wektory
+ * długości co najmniej progu Karatsuby mnożone są algorytmem Karatsuby,
+ * a krótsze mnożeniem szkolnym.
+ * @param[in] a : wektor współczynników pierwszego czynnika
+ * @param[in] n : długość wektora @p a, co najmniej 1
+ * @param[in] b : wektor współczynników drugiego czynnika
+ * @param[in] m : długość wektora @p b, co najmniej 1
+ * @param[out] out : wektor długości @f$n + m - 1@f$ na iloczyn
+ * */
+void denseMul(const poly_coeff_t *a, size_t n,
+              const poly_coeff_t *b, size_t m,
+              poly_coeff_t *out);
+
+/**
+ * Mnożenie dwóch gęstych wektorów współczynników z wykrywaniem
+ * przepełnienia. Wektory mnożone są transformatą niezależnie od progów,
+ * bo odtwarza ona dokładne wartości współczynników iloczynu. Dla @p a
+ * równego @p b wykonywana jest jedna transformata w przód.
+ * @param[in] a : wektor współczynników pierwszego czynnika
+ * @param[in] n : długość wektora @p a, co najmniej 1
+ * @param[in] b : wektor współczynników drugiego czynnika
+ * @param[in] m : długość wektora @p b, co najmniej 1
+ * @param[out] out : wektor długości @f$n + m - 1@f$ na iloczyn
+ * modulo @f$2^{64}@f$
+ * @return czy któryś dokładny współczynnik iloczynu nie mieści się
+ * w poly_coeff_t
+ * */
+bool denseMulChecked(const poly_coeff_t *a, size_t n,
+                     const poly_coeff_t *b, size_t m,
+                     poly_coeff_t *out);
+
+/**
+ * Podnoszenie gęstego wektora współczynników do kwadratu.
+ * Algorytm wybierany jest jak w denseMul(), lecz każdy wariant korzysta
+ * z symetrii kwadratu: mnożenie szkolne wylicza każdy iloczyn różnych
+ * współczynników raz, algorytm Karatsuby schodzi do trzech kwadratów,
+ * a transformata wyliczana jest raz zamiast dwóch razy.
+ * @param[in] a : wektor współczynników podnoszonego wielomianu
+ * @param[in] n : długość wektora @p a, co najmniej 1
+ * @param[out] out : wektor długości @f$2n - 1@f$ na kwadrat
+ * */
+void denseSquare(const poly_coeff_t *a, size_t n, poly_coeff_t *out);
+
+/**
+ * Ustawienie progu algorytmu Karatsuby.
+ * Poniżej progu używane jest mnożenie szkolne, a w module poly mnożenie
+ * rzadkie. Próg mniejszy niż 2 traktowany jest jak 2.
+ * @param[in] threshold : nowy próg
+ * */
+void setKaratsubaThreshold(size_t threshold);
+
+/**
+ * Aktualny próg algorytmu Karatsuby.
+ * @return próg algorytmu Karatsuby
+ * */
+size_t getKaratsubaThreshold(void);
+
+/**
+ * Ustawienie progu mnożenia transformatą teoretycznoliczbową.
+ * Próg mniejszy niż 1 traktowany jest jak 1.
+ * @param[in] threshold : nowy próg
+ * */
+void setNttThreshold(size_t threshold);
+
+/**
+ * Aktualny próg mnożenia transformatą teoretycznoliczbową.
+ * @return próg mnożenia transformatą
+ * */
+size_t getNttThreshold(void);
+
+#endif //DENSE_MUL_H
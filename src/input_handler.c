@@ -30,12 +30,16 @@ Command commands[] = {
         {"CLONE", handleClone, false},
         {"ADD", handleAdd, false},
         {"MUL", handleMul, false},
+        {"POW", handlePow, true},
         {"NEG", handleNeg, false},
         {"SUB", handleSub, false},
         {"IS_EQ", handleIsEq, false},
         {"DEG_BY", handleDegBy, true},
         {"DEG", handleDeg, false},
+        {"AT_MANY", handleAtMany, true},
         {"AT", handleAt, true},
+        {"EVAL_MANY", handleEvalMany, true},
+        {"EVAL", handleEval, true},
         {"PRINT", handlePrint, false},
         {"POP", handlePop, false},
         {"COMPOSE", handleCompose, true}
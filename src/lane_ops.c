@@ -0,0 +1,341 @@
+/** @file
+ * Implementacja operacji na wektorach wartości 64-bitowych.
+ *
+ * Jedynie AVX-512DQ ma mnożenie 64-bitowych liczb całkowitych w wektorach.
+ * W SSE4.1 i AVX2 niższą połowę iloczynu
+ * @f$(a_h 2^{32} + a_l)(b_h 2^{32} + b_l)@f$ składa się z iloczynu
+ * @f$a_l b_l@f$ i przesuniętej sumy mniej znaczących połówek iloczynów
+ * @f$a_l b_h@f$ oraz @f$a_h b_l@f$. Implementacje zestawów instrukcji
+ * kompilowane są z atrybutem target, więc nie wymagają opcji kompilatora,
+ * a wybierane są dopiero po sprawdzeniu procesora.
+ * */
+
+#include <assert.h>
+#include "lane_ops.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+/** Czy dostępne są implementacje dla procesorów x86. */
+#define LANE_OPS_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * Mnożenie wektorów bez instrukcji wektorowych.
+ * @param[out] dst : wynik
+ * @param[in] a : pierwszy czynnik
+ * @param[in] b : drugi czynnik
+ * @param[in] n : długość wektorów
+ * */
+static void scalarMul(unsigned long *dst, const unsigned long *a,
+                      const unsigned long *b, size_t n) {
+    for (size_t j = 0; j < n; ++j)
+        dst[j] = a[j] * b[j];
+}
+
+/**
+ * Mnożenie z dodawaniem wektorów bez instrukcji wektorowych.
+ * @param[out] dst : wynik
+ * @param[in] a : pierwszy czynnik
+ * @param[in] b : drugi czynnik
+ * @param[in] c : składnik
+ * @param[in] n : długość wektorów
+ * */
+static void scalarMulAdd(unsigned long *dst, const unsigned long *a,
+                         const unsigned long *b, const unsigned long *c,
+                         size_t n) {
+    for (size_t j = 0; j < n; ++j)
+        dst[j] = a[j] * b[j] + c[j];
+}
+
+/**
+ * Mnożenie wektorów z dodaniem stałej bez instrukcji wektorowych.
+ * @param[out] dst : wynik
+ * @param[in] a : pierwszy czynnik
+ * @param[in] b : drugi czynnik
+ * @param[in] imm : składnik
+ * @param[in] n : długość wektorów
+ * */
+static void scalarMulAddConst(unsigned long *dst, const unsigned long *a,
+                              const unsigned long *b, unsigned long imm,
+                              size_t n) {
+    for (size_t j = 0; j < n; ++j)
+        dst[j] = a[j] * b[j] + imm;
+}
+
+#ifdef LANE_OPS_X86
+
+/**
+ * Mnożenie modulo @f$2^{64}@f$ dwóch par wartości SSE4.1.
+ * @param[in] a : pierwsze czynniki
+ * @param[in] b : drugie czynniki
+ * @return iloczyny
+ * */
+__attribute__((target("sse4.1")))
+static inline __m128i sseMul64(__m128i a, __m128i b) {
+    __m128i cross = _mm_mullo_epi32(a, _mm_shuffle_epi32(b, 0xB1));
+    __m128i high = _mm_slli_epi64(_mm_add_epi32(cross,
+                                                _mm_srli_epi64(cross, 32)),
+                                  32);
+    return _mm_add_epi64(_mm_mul_epu32(a, b), high);
+}
+
+/**
+ * Mnożenie wektorów SSE4.1.
+ * @param[out] dst : wynik
+ * @param[in] a : pierwszy czynnik
+ * @param[in] b : drugi czynnik
+ * @param[in] n : długość wektorów
+ * */
+__attribute__((target("sse4.1")))
+static void sseMul(unsigned long *dst, const unsigned long *a,
+                   const unsigned long *b, size_t n) {
+    size_t j = 0;
+    for (; j + 2 <= n; j += 2) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (a + j));
+        __m128i y = _mm_loadu_si128((const __m128i *) (b + j));
+        _mm_storeu_si128((__m128i *) (dst + j), sseMul64(x, y));
+    }
+    scalarMul(dst + j, a + j, b + j, n - j);
+}
+
+/**
+ * Mnożenie z dodawaniem wektorów SSE4.1.
+ * @param[out] dst : wynik
+ * @param[in] a : pierwszy czynnik
+ * @param[in] b : drugi czynnik
+ * @param[in] c : składnik
+ * @param[in] n : długość wektorów
+ * */
+__attribute__((target("sse4.1")))
+static void sseMulAdd(unsigned long *dst, const unsigned long *a,
+                      const unsigned long *b, const unsigned long *c,
+                      size_t n) {
+    size_t j = 0;
+    for (; j + 2 <= n; j += 2) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (a + j));
+        __m128i y = _mm_loadu_si128((const __m128i *) (b + j));
+        __m128i z = _mm_loadu_si128((const __m128i *) (c + j));
+        _mm_storeu_si128((__m128i *) (dst + j),
+                         _mm_add_epi64(sseMul64(x, y), z));
+    }
+    scalarMulAdd(dst + j, a + j, b + j, c + j, n - j);
+}
+
+/**
+ * Mnożenie wektorów z dodaniem stałej SSE4.1.
+ * @param[out] dst : wynik
+ * @param[in] a : pierwszy czynnik
+ * @param[in] b : drugi czynnik
+ * @param[in] imm : składnik
+ * @param[in] n : długość wektorów
+ * */
+__attribute__((target("sse4.1")))
+static void sseMulAddConst(unsigned long *dst, const unsigned long *a,
+                           const unsigned long *b, unsigned long imm,
+                           size_t n) {
+    __m128i z = _mm_set1_epi64x((long long) imm);
+    size_t j = 0;
+    for (; j + 2 <= n; j += 2) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (a + j));
+        __m128i y = _mm_loadu_si128((const __m128i *) (b + j));
+        _mm_storeu_si128((__m128i *) (dst + j),
+                         _mm_add_epi64(sseMul64(x, y), z));
+    }
+    scalarMulAddConst(dst + j, a + j, b + j, imm, n - j);
+}
+
+/**
+ * Mnożenie modulo @f$2^{64}@f$ czterech par wartości AVX2.
+ * @param[in] a : pierwsze czynniki
+ * @param[in] b : drugie czynniki
+ * @return iloczyny
+ * */
+__attribute__((target("avx2")))
+static inline __m256i avxMul64(__m256i a, __m256i b) {
+    __m256i cross = _mm256_mullo_epi32(a, _mm256_shuffle_epi32(b, 0xB1));
+    __m256i high = _mm256_slli_epi64(
+            _mm256_add_epi32(cross, _mm256_srli_epi64(cross, 32)), 32);
+    return _mm256_add_epi64(_mm256_mul_epu32(a, b), high);
+}
+
+/**
+ * Mnożenie wektorów AVX2.
+ * @param[out] dst : wynik
+ * @param[in] a : pierwszy czynnik
+ * @param[in] b : drugi czynnik
+ * @param[in] n : długość wektorów
+ * */
+__attribute__((target("avx2")))
+static void avxMul(unsigned long *dst, const unsigned long *a,
+                   const unsigned long *b, size_t n) {
+    size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (a + j));
+        __m256i y = _mm256_loadu_si256((const __m256i *) (b + j));
+        _mm256_storeu_si256((__m256i *) (dst + j), avxMul64(x, y));
+    }
+    scalarMul(dst + j, a + j, b + j, n - j);
+}
+
+/**
+ * Mnożenie z dodawaniem wektorów AVX2.
+ * @param[out] dst : wynik
+ * @param[in] a : pierwszy czynnik
+ * @param[in] b : drugi czynnik
+ * @param[in] c : składnik
+ * @param[in] n : długość wektorów
+ * */
+__attribute__((target("avx2")))
+static void avxMulAdd(unsigned long *dst, const unsigned long *a,
+                      const unsigned long *b, const unsigned long *c,
+                      size_t n) {
+    size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (a + j));
+        __m256i y = _mm256_loadu_si256((const __m256i *) (b + j));
+        __m256i z = _mm256_loadu_si256((const __m256i *) (c + j));
+        _mm256_storeu_si256((__m256i *) (dst + j),
+                            _mm256_add_epi64(avxMul64(x, y), z));
+    }
+    scalarMulAdd(dst + j, a + j, b + j, c + j, n - j);
+}
+
+/**
+ * Mnożenie wektorów z dodaniem stałej AVX2.
+ * @param[out] dst : wynik
+ * @param[in] a : pierwszy czynnik
+ * @param[in] b : drugi czynnik
+ * @param[in] imm : składnik
+ * @param[in] n : długość wektorów
+ * */
+__attribute__((target("avx2")))
+static void avxMulAddConst(unsigned long *dst, const unsigned long *a,
+                           const unsigned long *b, unsigned long imm,
+                           size_t n) {
+    __m256i z = _mm256_set1_epi64x((long long) imm);
+    size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (a + j));
+        __m256i y = _mm256_loadu_si256((const __m256i *) (b + j));
+        _mm256_storeu_si256((__m256i *) (dst + j),
+                            _mm256_add_epi64(avxMul64(x, y), z));
+    }
+    scalarMulAddConst(dst + j, a + j, b + j, imm, n - j);
+}
+
+/**
+ * Mnożenie wektorów AVX-512.
+ * @param[out] dst : wynik
+ * @param[in] a : pierwszy czynnik
+ * @param[in] b : drugi czynnik
+ * @param[in] n : długość wektorów
+ * */
+__attribute__((target("avx512f,avx512dq")))
+static void avx512Mul(unsigned long *dst, const unsigned long *a,
+                      const unsigned long *b, size_t n) {
+    size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m512i x = _mm512_loadu_si512(a + j);
+        __m512i y = _mm512_loadu_si512(b + j);
+        _mm512_storeu_si512(dst + j, _mm512_mullo_epi64(x, y));
+    }
+    scalarMul(dst + j, a + j, b + j, n - j);
+}
+
+/**
+ * Mnożenie z dodawaniem wektorów AVX-512.
+ * @param[out] dst : wynik
+ * @param[in] a : pierwszy czynnik
+ * @param[in] b : drugi czynnik
+ * @param[in] c : składnik
+ * @param[in] n : długość wektorów
+ * */
+__attribute__((target("avx512f,avx512dq")))
+static void avx512MulAdd(unsigned long *dst, const unsigned long *a,
+                         const unsigned long *b, const unsigned long *c,
+                         size_t n) {
+    size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m512i x = _mm512_loadu_si512(a + j);
+        __m512i y = _mm512_loadu_si512(b + j);
+        __m512i z = _mm512_loadu_si512(c + j);
+        _mm512_storeu_si512(dst + j,
+                            _mm512_add_epi64(_mm512_mullo_epi64(x, y), z));
+    }
+    scalarMulAdd(dst + j, a + j, b + j, c + j, n - j);
+}
+
+/**
+ * Mnożenie wektorów z dodaniem stałej AVX-512.
+ * @param[out] dst : wynik
+ * @param[in] a : pierwszy czynnik
+ * @param[in] b : drugi czynnik
+ * @param[in] imm : składnik
+ * @param[in] n : długość wektorów
+ * */
+__attribute__((target("avx512f,avx512dq")))
+static void avx512MulAddConst(unsigned long *dst, const unsigned long *a,
+                              const unsigned long *b, unsigned long imm,
+                              size_t n) {
+    __m512i z = _mm512_set1_epi64((long long) imm);
+    size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m512i x = _mm512_loadu_si512(a + j);
+        __m512i y = _mm512_loadu_si512(b + j);
+        _mm512_storeu_si512(dst + j,
+                            _mm512_add_epi64(_mm512_mullo_epi64(x, y), z));
+    }
+    scalarMulAddConst(dst + j, a + j, b + j, imm, n - j);
+}
+
+#endif //LANE_OPS_X86
+
+/** Operacje kolejnych zestawów instrukcji. */
+static const LaneOps laneOps[LANE_ISA_COUNT] = {
+        [LANE_SCALAR] = {scalarMul, scalarMulAdd, scalarMulAddConst},
+#ifdef LANE_OPS_X86
+        [LANE_SSE41] = {sseMul, sseMulAdd, sseMulAddConst},
+        [LANE_AVX2] = {avxMul, avxMulAdd, avxMulAddConst},
+        [LANE_AVX512] = {avx512Mul, avx512MulAdd, avx512MulAddConst},
+#else
+        [LANE_SSE41] = {scalarMul, scalarMulAdd, scalarMulAddConst},
+        [LANE_AVX2] = {scalarMul, scalarMulAdd, scalarMulAddConst},
+        [LANE_AVX512] = {scalarMul, scalarMulAdd, scalarMulAddConst},
+#endif
+};
+
+bool laneOpsSupported(LaneIsa isa) {
+#ifdef LANE_OPS_X86
+    __builtin_cpu_init();
+
+    switch (isa) {
+        case LANE_SCALAR:
+            return true;
+        case LANE_SSE41:
+            return __builtin_cpu_supports("sse4.1");
+        case LANE_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case LANE_AVX512:
+            return __builtin_cpu_supports("avx512f")
+                   && __builtin_cpu_supports("avx512dq");
+        default:
+            return false;
+    }
+#else
+    return isa == LANE_SCALAR;
+#endif
+}
+
+const LaneOps *laneOpsFor(LaneIsa isa) {
+    assert(laneOpsSupported(isa));
+    return &laneOps[isa];
+}
+
+const LaneOps *laneOpsBest(void) {
+    for (size_t isa = LANE_ISA_COUNT - 1; isa > LANE_SCALAR; --isa) {
+        if (laneOpsSupported(isa))
+            return &laneOps[isa];
+    }
+
+    return &laneOps[LANE_SCALAR];
+}
@@ -0,0 +1,59 @@
+/** @file
+ * Interfejs modułu operacji na wektorach wartości 64-bitowych.
+ *
+ * Operacje wykonywane są element po elemencie modulo @f$2^{64}@f$, więc
+ * ich wyniki są identyczne z wynikami arytmetyki na przekręcającym się
+ * typie poly_coeff_t. Każdy zestaw instrukcji procesora ma własną
+ * implementację operacji, a laneOpsBest() wybiera najszybszą z nich
+ * dostępną na bieżącym procesorze.
+ * */
+
+#ifndef LANE_OPS_H
+#define LANE_OPS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Zestaw instrukcji procesora. */
+typedef enum {
+    LANE_SCALAR, ///< zwykła arytmetyka, dostępna zawsze
+    LANE_SSE41, ///< SSE4.1, dwie wartości na instrukcję
+    LANE_AVX2, ///< AVX2, cztery wartości na instrukcję
+    LANE_AVX512, ///< AVX-512F i AVX-512DQ, osiem wartości na instrukcję
+    LANE_ISA_COUNT ///< liczba zestawów instrukcji
+} LaneIsa;
+
+/** Operacje na wektorach długości @f$n@f$, wynik może nadpisać argument. */
+typedef struct {
+    /** @f$dst_j = a_j b_j@f$ */
+    void (*mul)(unsigned long *dst, const unsigned long *a,
+                const unsigned long *b, size_t n);
+    /** @f$dst_j = a_j b_j + c_j@f$ */
+    void (*mulAdd)(unsigned long *dst, const unsigned long *a,
+                   const unsigned long *b, const unsigned long *c, size_t n);
+    /** @f$dst_j = a_j b_j + imm@f$ */
+    void (*mulAddConst)(unsigned long *dst, const unsigned long *a,
+                        const unsigned long *b, unsigned long imm, size_t n);
+} LaneOps;
+
+/**
+ * Sprawdzenie, czy procesor obsługuje zestaw instrukcji.
+ * @param[in] isa : zestaw instrukcji
+ * @return czy operacje tego zestawu można wykonać
+ * */
+bool laneOpsSupported(LaneIsa isa);
+
+/**
+ * Operacje zestawu instrukcji.
+ * @param[in] isa : zestaw instrukcji obsługiwany przez procesor
+ * @return operacje zestawu
+ * */
+const LaneOps *laneOpsFor(LaneIsa isa);
+
+/**
+ * Operacje najszybszego zestawu instrukcji obsługiwanego przez procesor.
+ * @return operacje zestawu
+ * */
+const LaneOps *laneOpsBest(void);
+
+#endif //LANE_OPS_H
@@ -291,6 +291,10 @@ bool canBeComp(char *str, size_t *comp, char **endPtr) {
     return canBeDeg(str, comp, endPtr);
 }
 
+bool canBePow(char *str, poly_exp_t *exp, char **endPtr) {
+    return canBeExp(str, exp, endPtr);
+}
+
 bool canBeCoeff(char *str, poly_coeff_t *number, char **endPtr) {
     long long tempNumber;
     bool toReturn = canBeNumber(str, &tempNumber, endPtr, LONG);
@@ -328,3 +332,29 @@ bool CanBePoly(char *str, Poly *p) {
 bool isInRange(const char begin, const char end, const char c) {
     return begin <= c && c <= end;
 }
+
+bool canBeCoeffList(char *str, size_t *count, poly_coeff_t **values) {
+    size_t size = 1;
+    for (char *c = str; *c != '\0'; ++c)
+        if (is(c, ' '))
+            size++;
+
+    poly_coeff_t *list = safeCalloc(size, sizeof(poly_coeff_t));
+    char *strPtr = str;
+
+    for (size_t i = 0; i < size; ++i) {
+        char *endPtr;
+        char separator = (i + 1 < size) ? ' ' : '\0';
+
+        if (!canBeCoeff(strPtr, &list[i], &endPtr) || *endPtr != separator) {
+            safeFree((void **) &list);
+            return false;
+        }
+
+        strPtr = endPtr + 1;
+    }
+
+    *count = size;
+    *values = list;
+    return true;
+}
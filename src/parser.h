@@ -96,4 +96,30 @@ bool canBeCoeff(char *str, poly_coeff_t *number, char **endPtr);
  * */
 bool canBeComp(char *str, size_t *comp, char **endPtr);
 
+/**
+ * Sprawdzenie czy w str znajduje się coś mogącego być argumentem
+ * polecenia POW, czyli wykładnikiem jednomianu.
+ * W przypadku poprawnego wczytania czegoś będącego argumentem
+ * do zmiennej exp zostanie wpisana ta wartość, a wskaźnik endPtr zostanie
+ * ustawiony na pierwszy znak nie będący argumentem.
+ * @param[in] str : sprawdzany ciąg znaków
+ * @param[out] exp : wynik wczytania argumentu
+ * @param[out] endPtr : pierwszy znak za argumentem
+ * @return czy w str znajduje się argument POW
+ * */
+bool canBePow(char *str, poly_exp_t *exp, char **endPtr);
+
+/**
+ * Sprawdzenie czy str jest niepustą listą współczynników wielomianu
+ * oddzielonych pojedynczymi spacjami.
+ * W przypadku poprawnego wczytania listy do zmiennej count zostanie wpisana
+ * jej długość, a do zmiennej values tablica wczytanych wartości zaalokowana
+ * na stercie, którą należy zwolnić.
+ * @param[in] str : sprawdzany ciąg znaków
+ * @param[out] count : liczba wczytanych współczynników
+ * @param[out] values : wczytane współczynniki
+ * @return czy str jest listą współczynników
+ * */
+bool canBeCoeffList(char *str, size_t *count, poly_coeff_t **values);
+
 #endif //PARSER_PARSER_H
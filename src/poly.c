@@ -12,8 +12,391 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <pthread.h>
 #include "poly.h"
 #include "memory.h"
+#include "dense_mul.h"
+#include "thread_pool.h"
+
+/**
+ * Największe wykładniki na kolejnych poziomach wielomianu.
+ * Poziom @f$l@f$ odpowiada zmiennej @f$x_l@f$.
+ * */
+typedef struct {
+    size_t depth; ///< liczba poziomów, czyli liczba zmiennych wielomianu
+    poly_exp_t degs[]; ///< największy wykładnik na każdym poziomie
+} LevelDegs;
+
+/** Wartość pola MonosHeader::deg oznaczająca niewyznaczony stopień. */
+#define DEG_UNKNOWN (-1)
+
+/**
+ * Nagłówek tablicy jednomianów.
+ * Każda tablica jednomianów wielomianu niestałego poprzedzona jest
+ * w pamięci nagłówkiem z licznikiem odwołań. Przy włączonym współdzieleniu
+ * PolyClone() jedynie zwiększa licznik, a funkcje modyfikujące tablicę
+ * najpierw wykonują jej płytką kopię, jeżeli korzysta z niej kilka
+ * wielomianów (kopiowanie przy zapisie). Tablice internowane znajdują się
+ * dodatkowo w globalnej tablicy haszującej. Nagłówek przechowuje też
+ * wyznaczone stopnie wielomianu, unieważniane przez monosMakeUnique().
+ * */
+typedef struct {
+    _Alignas(16) atomic_size_t refs; ///< liczba wielomianów używających tablicy
+    uint64_t hash; ///< hasz wielomianu, ważny dla tablic internowanych
+    size_t size; ///< liczba jednomianów, ważna dla tablic internowanych
+    Mono *next; ///< następna tablica w kubełku tablicy haszującej
+    _Atomic(LevelDegs *) levelDegs; ///< stopnie poziomów lub NULL
+    atomic_int deg; ///< stopień wielomianu lub DEG_UNKNOWN
+    bool interned; ///< czy tablica znajduje się w tablicy haszującej
+} MonosHeader;
+
+/** Czy PolyClone() współdzieli tablice jednomianów zamiast je kopiować. */
+static bool sharingEnabled = false;
+
+/** Czy wyniki operacji są internowane. */
+static bool interningEnabled = false;
+
+/** Czy przepełnienia działań na współczynnikach są odnotowywane. */
+static bool overflowCheckEnabled = false;
+
+/** Czy od ostatniego PolyClearOverflow() wystąpiło przepełnienie. */
+static atomic_bool overflowOccurred = false;
+
+/** Początkowa liczba kubełków tablicy internowanych wielomianów. */
+#define INIT_INTERN_BUCKETS 1024
+
+/**
+ * Tablica haszująca internowanych wielomianów.
+ * Kubełki są listami tablic jednomianów połączonymi polem
+ * MonosHeader::next. Tablica nie trzyma odwołań: tablica jednomianów jest
+ * z niej usuwana, gdy zwalniane jest ostatnie odwołanie do niej.
+ * */
+static struct {
+    pthread_mutex_t lock; ///< blokada tablicy i liczników tablic internowanych
+    Mono **buckets; ///< kubełki
+    size_t capacity; ///< liczba kubełków, potęga dwójki
+    size_t size; ///< liczba internowanych tablic
+} internTable = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+/**
+ * Nagłówek tablicy jednomianów.
+ * @param[in] monos : tablica jednomianów
+ * @return nagłówek tablicy
+ * */
+static inline MonosHeader *monosHeader(const Mono *monos) {
+    return (MonosHeader *) monos - 1;
+}
+
+/**
+ * Inicjalizacja nagłówka nowej tablicy jednomianów o jednym właścicielu.
+ * @param[out] header : nagłówek
+ * @return tablica jednomianów następująca po nagłówku
+ * */
+static Mono *monosHeaderInit(MonosHeader *header) {
+    atomic_init(&header->refs, 1);
+    header->hash = 0;
+    header->size = 0;
+    header->next = NULL;
+    atomic_init(&header->levelDegs, NULL);
+    atomic_init(&header->deg, DEG_UNKNOWN);
+    header->interned = false;
+    return (Mono *) (header + 1);
+}
+
+/**
+ * Alokacja tablicy jednomianów z nagłówkiem.
+ * Tablica ma jednego właściciela.
+ * @param[in] count : liczba jednomianów
+ * @return tablica jednomianów
+ * */
+static Mono *monosAlloc(size_t count) {
+    return monosHeaderInit(safeMalloc(sizeof(MonosHeader)
+                                      + count * sizeof(Mono)));
+}
+
+/**
+ * Zmiana rozmiaru tablicy jednomianów o jednym właścicielu.
+ * @param[in] monos : tablica jednomianów
+ * @param[in] count : nowa liczba jednomianów
+ * @return tablica jednomianów po zmianie rozmiaru
+ * */
+static Mono *monosRealloc(Mono *monos, size_t count) {
+    assert(atomic_load(&monosHeader(monos)->refs) == 1);
+    assert(!monosHeader(monos)->interned);
+    MonosHeader *header = safeRealloc(monosHeader(monos), sizeof(MonosHeader)
+                                                          + count * sizeof(Mono));
+    return (Mono *) (header + 1);
+}
+
+/**
+ * Zwolnienie pamięci tablicy jednomianów bez usuwania jednomianów.
+ * @param[in,out] monos : wskaźnik na tablicę, ustawiany na NULL
+ * */
+static void monosFree(Mono **monos) {
+    if (*monos != NULL) {
+        free(atomic_load_explicit(&monosHeader(*monos)->levelDegs,
+                                  memory_order_relaxed));
+        free(monosHeader(*monos));
+    }
+    *monos = NULL;
+}
+
+/**
+ * Unieważnienie stopni zapisanych w nagłówku tablicy jednomianów
+ * przed jej modyfikacją. Tablica musi mieć jednego właściciela.
+ * @param[in] monos : tablica jednomianów
+ * */
+static void monosInvalidateDegs(Mono *monos) {
+    MonosHeader *header = monosHeader(monos);
+
+    LevelDegs *levelDegs = atomic_load_explicit(&header->levelDegs,
+                                                memory_order_relaxed);
+
+    atomic_store_explicit(&header->deg, DEG_UNKNOWN, memory_order_relaxed);
+    if (levelDegs != NULL) {
+        atomic_store_explicit(&header->levelDegs, NULL, memory_order_relaxed);
+        free(levelDegs);
+    }
+}
+
+/**
+ * Sprawdzenie, czy tablica jednomianów ma jednego właściciela.
+ * @param[in] monos : tablica jednomianów
+ * @return czy tablica nie jest współdzielona
+ * */
+static inline bool monosIsUnique(const Mono *monos) {
+    return atomic_load_explicit(&monosHeader(monos)->refs,
+                                memory_order_acquire) == 1;
+}
+
+/**
+ * Kubełek tablicy haszującej dla danego haszu.
+ * Wymaga blokady tablicy.
+ * @param[in] hash : hasz
+ * @return wskaźnik na początek listy kubełka
+ * */
+static Mono **internBucket(uint64_t hash) {
+    return &internTable.buckets[hash & (internTable.capacity - 1)];
+}
+
+/**
+ * Usunięcie tablicy jednomianów z tablicy haszującej.
+ * Wymaga blokady tablicy.
+ * @param[in] monos : internowana tablica jednomianów
+ * */
+static void internRemove(Mono *monos) {
+    MonosHeader *header = monosHeader(monos);
+    Mono **link = internBucket(header->hash);
+
+    while (*link != monos)
+        link = &monosHeader(*link)->next;
+
+    *link = header->next;
+    header->next = NULL;
+    header->interned = false;
+    internTable.size--;
+}
+
+/**
+ * Podwojenie liczby kubełków tablicy haszującej.
+ * Wymaga blokady tablicy.
+ * */
+static void internGrow(void) {
+    Mono **old = internTable.buckets;
+    size_t oldCapacity = internTable.capacity;
+
+    internTable.capacity = (oldCapacity == 0) ? INIT_INTERN_BUCKETS
+                                              : 2 * oldCapacity;
+    internTable.buckets = safeCalloc(internTable.capacity, sizeof(Mono *));
+
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        Mono *monos = old[i];
+        while (monos != NULL) {
+            MonosHeader *header = monosHeader(monos);
+            Mono *next = header->next;
+            Mono **bucket = internBucket(header->hash);
+
+            header->next = *bucket;
+            *bucket = monos;
+            monos = next;
+        }
+    }
+
+    safeFree((void **) &old);
+}
+
+/**
+ * Porzucenie odwołania do tablicy jednomianów.
+ * Ostatnie odwołanie do tablicy internowanej usuwa ją z tablicy haszującej.
+ * @param[in] monos : tablica jednomianów
+ * @return czy było to ostatnie odwołanie, czyli czy należy usunąć tablicę
+ * */
+static bool monosRelease(Mono *monos) {
+    MonosHeader *header = monosHeader(monos);
+
+    if (header->interned) {
+        pthread_mutex_lock(&internTable.lock);
+        bool last = atomic_fetch_sub(&header->refs, 1) == 1;
+        if (last)
+            internRemove(monos);
+        pthread_mutex_unlock(&internTable.lock);
+        return last;
+    }
+
+    if (monosIsUnique(monos))
+        return true;
+
+    return atomic_fetch_sub_explicit(&header->refs, 1,
+                                     memory_order_acq_rel) == 1;
+}
+
+/**
+ * Zapewnienie wyłącznej własności tablicy jednomianów przed modyfikacją.
+ * Współdzielona tablica zastępowana jest płytką kopią, w której
+ * współczynniki jednomianów nadal mogą być współdzielone. Internowana
+ * tablica o jednym właścicielu jest usuwana z tablicy haszującej.
+ * Zapisane stopnie wielomianu przestają być ważne.
+ * @param[in,out] p : wielomian
+ * */
+static void monosMakeUnique(Poly *p) {
+    if (PolyIsCoeff(p))
+        return;
+
+    if (monosHeader(p->arr)->interned) {
+        pthread_mutex_lock(&internTable.lock);
+        bool unique = monosIsUnique(p->arr);
+        if (unique)
+            internRemove(p->arr);
+        pthread_mutex_unlock(&internTable.lock);
+
+        if (unique) {
+            monosInvalidateDegs(p->arr);
+            return;
+        }
+    }
+    else if (monosIsUnique(p->arr)) {
+        monosInvalidateDegs(p->arr);
+        return;
+    }
+
+    Poly old = *p;
+    p->arr = monosAlloc(p->size);
+    for (size_t i = 0; i < p->size; ++i)
+        p->arr[i] = MonoClone(&old.arr[i]);
+
+    PolyDestroy(&old);
+}
+
+/**
+ * Wymieszanie bitów liczby 64-bitowej (funkcja końcowa SplitMix64).
+ * @param[in] x : liczba
+ * @return wymieszana liczba
+ * */
+static inline uint64_t hashMix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * Strukturalny hasz wielomianu.
+ * Równe wielomiany mają równe hasze. Dla tablic internowanych wykorzystywany
+ * jest hasz zapisany w nagłówku.
+ * @param[in] p : wielomian
+ * @return hasz wielomianu
+ * */
+static uint64_t polyHash(const Poly *p) {
+    if (PolyIsCoeff(p))
+        return hashMix((uint64_t) p->coeff);
+
+    if (monosHeader(p->arr)->interned)
+        return monosHeader(p->arr)->hash;
+
+    uint64_t hash = hashMix(p->size ^ 0x9e3779b97f4a7c15ULL);
+    for (size_t i = 0; i < p->size; ++i) {
+        hash = hashMix(hash ^ (uint64_t) MonoGetExp(&p->arr[i]));
+        hash = hashMix(hash + polyHash(&p->arr[i].p));
+    }
+
+    return hash;
+}
+
+/**
+ * Sprawdzenie równości jednomianów dwóch wielomianów niestałych
+ * bez zaglądania głębiej niż do bezpośrednich współczynników, o ile są
+ * one internowane.
+ * @param[in] p : wielomian niestały
+ * @param[in] q : wielomian niestały
+ * @return czy wielomiany są równe
+ * */
+static bool monosAreEq(const Poly *p, const Poly *q) {
+    if (p->size != q->size)
+        return false;
+
+    for (size_t i = 0; i < p->size; ++i)
+        if (MonoGetExp(&p->arr[i]) != MonoGetExp(&q->arr[i])
+            || !PolyIsEq(&p->arr[i].p, &q->arr[i].p))
+            return false;
+
+    return true;
+}
+
+/**
+ * Internowanie wielomianu.
+ * Jeżeli w tablicy haszującej jest już równy wielomian, to wielomian
+ * @f$p@f$ jest usuwany i zwracane jest nowe odwołanie do znalezionej
+ * tablicy. W przeciwnym razie tablica @f$p@f$ jest dodawana do tablicy
+ * haszującej. Współczynniki @f$p@f$ powinny być już internowane.
+ * Wielomian przyjmowany jest na własność, a jego tablica musi mieć
+ * jednego właściciela.
+ * @param[in] p : wielomian
+ * @return wielomian równy @f$p@f$
+ * */
+static Poly polyIntern(Poly p) {
+    if (!interningEnabled || PolyIsCoeff(&p))
+        return p;
+
+    assert(monosIsUnique(p.arr) && !monosHeader(p.arr)->interned);
+    uint64_t hash = polyHash(&p);
+
+    pthread_mutex_lock(&internTable.lock);
+
+    if (internTable.size >= internTable.capacity)
+        internGrow();
+
+    Mono **bucket = internBucket(hash);
+    for (Mono *monos = *bucket; monos != NULL;
+         monos = monosHeader(monos)->next) {
+        MonosHeader *header = monosHeader(monos);
+        Poly candidate = {.size = header->size, .arr = monos};
+
+        if (header->hash == hash && monosAreEq(&candidate, &p)) {
+            atomic_fetch_add(&header->refs, 1);
+            pthread_mutex_unlock(&internTable.lock);
+
+            PolyDestroy(&p);
+            return candidate;
+        }
+    }
+
+    MonosHeader *header = monosHeader(p.arr);
+    header->hash = hash;
+    header->size = p.size;
+    header->interned = true;
+    header->next = *bucket;
+    *bucket = p.arr;
+    internTable.size++;
+
+    pthread_mutex_unlock(&internTable.lock);
+    return p;
+}
 
 /**
  * Sprawdzenie czy wielomian @f$p@f$ ma posortowaną tablicę jednomianów
@@ -194,21 +577,101 @@ static void sortMonosByExp(Mono *monos, size_t size) {
     qsort(monos, size, sizeof(Mono), compareMonosByExp);
 }
 
+/**
+ * Odnotowanie wyniku sprawdzenia przepełnienia działania.
+ * Bez wykrywania przepełnień wynik sprawdzenia nie jest odczytywany,
+ * więc częste przekręcanie się współczynników nie psuje przewidywania
+ * skoków. Przy wykrywaniu przepełnienie jest rzadkie, więc obie gałęzie
+ * oznaczone są jako mało prawdopodobne.
+ * @param[in] overflow : czy działanie się przepełniło
+ * */
+static inline void coeffCheck(bool overflow) {
+    if (__builtin_expect(overflowCheckEnabled, 0)
+        && __builtin_expect(overflow, 0))
+        atomic_store_explicit(&overflowOccurred, true, memory_order_relaxed);
+}
+
+/**
+ * Mnożenie współczynników modulo @f$2^{64}@f$ ze zbieraniem przepełnień.
+ * Wynik jest identyczny z przekręceniem się typu poly_coeff_t, lecz nie
+ * zależy od zachowania niezdefiniowanego. Pętle jąder zbierają
+ * przepełnienia w zmiennej lokalnej bez skoków i odnotowują je przez
+ * coeffCheck() po zakończeniu pętli.
+ * @param[in] a : pierwszy czynnik
+ * @param[in] b : drugi czynnik
+ * @param[in,out] overflow : flaga ustawiana przy przepełnieniu
+ * @return @f$a\cdot b@f$
+ * */
+static inline poly_coeff_t coeffMulTrack(poly_coeff_t a, poly_coeff_t b,
+                                         bool *overflow) {
+    poly_coeff_t res;
+    *overflow |= __builtin_mul_overflow(a, b, &res);
+    return res;
+}
+
+/**
+ * Dodawanie współczynników modulo @f$2^{64}@f$ ze zbieraniem przepełnień,
+ * jak w coeffMulTrack().
+ * @param[in] a : pierwszy składnik
+ * @param[in] b : drugi składnik
+ * @param[in,out] overflow : flaga ustawiana przy przepełnieniu
+ * @return @f$a + b@f$
+ * */
+static inline poly_coeff_t coeffAddTrack(poly_coeff_t a, poly_coeff_t b,
+                                         bool *overflow) {
+    poly_coeff_t res;
+    *overflow |= __builtin_add_overflow(a, b, &res);
+    return res;
+}
+
+/**
+ * Mnożenie współczynników modulo @f$2^{64}@f$.
+ * Przepełnienie jest odnotowywane.
+ * @param[in] a : pierwszy czynnik
+ * @param[in] b : drugi czynnik
+ * @return @f$a\cdot b@f$
+ * */
+static inline poly_coeff_t coeffMul(poly_coeff_t a, poly_coeff_t b) {
+    bool overflow = false;
+    poly_coeff_t res = coeffMulTrack(a, b, &overflow);
+    coeffCheck(overflow);
+    return res;
+}
+
+/**
+ * Dodawanie współczynników modulo @f$2^{64}@f$.
+ * Przepełnienie jest odnotowywane.
+ * @param[in] a : pierwszy składnik
+ * @param[in] b : drugi składnik
+ * @return @f$a + b@f$
+ * */
+static inline poly_coeff_t coeffAdd(poly_coeff_t a, poly_coeff_t b) {
+    bool overflow = false;
+    poly_coeff_t res = coeffAddTrack(a, b, &overflow);
+    coeffCheck(overflow);
+    return res;
+}
+
 /**
  * Algorytm szybkiego potęgowania.
- * Szybkie wyznaczenie liczby @f$a^n@f$.
+ * Szybkie wyznaczenie liczby @f$a^n@f$. Podstawa podnoszona jest do
+ * kwadratu tylko wtedy, gdy kwadrat jest potrzebny, więc przepełnienie
+ * jest odnotowywane jedynie, gdy nie mieści się wynik.
  * @param[in] a : podstawa
  * @param[in] n : wykładnik
  * @return @f$a^n@f$
  * */
 static inline poly_coeff_t fastPower(poly_coeff_t a, poly_exp_t n) {
-    if (n == 0)
-        return 1;
+    poly_coeff_t score = 1;
 
-    poly_coeff_t score = fastPower(a * a, n / 2);
+    while (n > 0) {
+        if (n % 2 == 1)
+            score = coeffMul(score, a);
 
-    if (n % 2 == 1)
-        score *= a;
+        n /= 2;
+        if (n > 0)
+            a = coeffMul(a, a);
+    }
 
     return score;
 }
@@ -224,6 +687,56 @@ static inline poly_exp_t max(poly_exp_t a, poly_exp_t b) {
     return (a > b) ? a : b;
 }
 
+/**
+ * Stopień wielomianu zapisany w nagłówku jego tablicy jednomianów.
+ * Niewyznaczony stopień jest wyliczany ze stopni współczynników
+ * i zapisywany, więc kolejne wywołania działają w czasie stałym.
+ * @param[in] p : wielomian
+ * @return stopień wielomianu @f$p@f$
+ * */
+static poly_exp_t polyDeg(const Poly *p) {
+    if (PolyIsCoeff(p))
+        return PolyIsZero(p) ? -1 : 0;
+
+    MonosHeader *header = monosHeader(p->arr);
+    poly_exp_t deg = atomic_load_explicit(&header->deg, memory_order_relaxed);
+    if (deg != DEG_UNKNOWN)
+        return deg;
+
+    deg = 0;
+    for (size_t i = 0; i < p->size; ++i)
+        deg = max(deg, MonoGetExp(&p->arr[i]) + polyDeg(&p->arr[i].p));
+
+    atomic_store_explicit(&header->deg, deg, memory_order_relaxed);
+    return deg;
+}
+
+/**
+ * Utworzenie wielomianu z posortowanych, niezerowych jednomianów
+ * o parami różnych wykładnikach.
+ * Przejmuje na własność tablicę @p monos zaalokowaną przez monosAlloc().
+ * @param[in] count : liczba jednomianów
+ * @param[in] monos : tablica jednomianów
+ * @return wielomian będący sumą jednomianów
+ * */
+static Poly polyFromUniqueMonos(size_t count, Mono *monos) {
+    if (count == 0) {
+        monosFree(&monos);
+        return PolyZero();
+    }
+
+    if (count == 1 && canMonoBeCut(&monos[0])) {
+        Poly res = monos[0].p;
+        monosFree(&monos);
+        return res;
+    }
+
+    Poly res = {.size = count, .arr = monosRealloc(monos, count)};
+    // Stopnie współczynników są już wyznaczone, więc koszt jest liniowy.
+    polyDeg(&res);
+    return polyIntern(res);
+}
+
 static Poly addMonosProperty(size_t count, Mono monos[]);
 
 /**
@@ -236,7 +749,7 @@ static Poly addMonosProperty(size_t count, Mono monos[]);
  * */
 static Poly addPropertyTwoCoeffs(Poly *a, Poly *b) {
     assert(PolyIsCoeff(a) && PolyIsCoeff(b));
-    return PolyFromCoeff(a->coeff + b->coeff);
+    return PolyFromCoeff(coeffAdd(a->coeff, b->coeff));
 }
 
 /**
@@ -245,6 +758,8 @@ static Poly addPropertyTwoCoeffs(Poly *a, Poly *b) {
  * @f$p(x_0) = \sum\limits_{i\in\mathbb{I}} x_0^i\cdot p_{0,i}(x_1)@f$
  * oraz wielomianu
  * @f$q(x_0) = \sum\limits_{i\in\mathbb{I}} x_0^i\cdot q_{0,i}(x_1)@f$.
+ * Tablica dłuższego wielomianu jest powiększana w miejscu, a jednomiany
+ * scalane są od końca, więc nie jest potrzebny dodatkowy bufor.
  * Wartości przyjmowane są na własność.
  * @param[in] a : wielomian @f$p@f$
  * @param[in] b : wielomian @f$q@f$
@@ -252,33 +767,34 @@ static Poly addPropertyTwoCoeffs(Poly *a, Poly *b) {
  * */
 static Poly addPropertyNonCoeffs(Poly *a, Poly *b) {
     assert(!PolyIsCoeff(a) && !PolyIsCoeff(b));
-    size_t monosCnt = a->size + b->size;
-    Mono *monos = safeCalloc(monosCnt, sizeof(Mono));
-
-    size_t ptr = 0;
-    size_t ptrA = 0;
-    size_t ptrB = 0;
 
-    while (ptrA < a->size && ptrB < b->size) {
-        if (a->arr[ptrA].exp > b->arr[ptrB].exp)
-            monos[ptr++] = a->arr[ptrA++];
-        else
-            monos[ptr++] = b->arr[ptrB++];
+    if (a->size < b->size) {
+        Poly *tmp = a;
+        a = b;
+        b = tmp;
     }
 
-    while (ptrA < a->size)
-        monos[ptr++] = a->arr[ptrA++];
+    monosMakeUnique(a);
+    monosMakeUnique(b);
 
-    while (ptrB < b->size)
-        monos[ptr++] = b->arr[ptrB++];
+    size_t monosCnt = a->size + b->size;
+    Mono *monos = monosRealloc(a->arr, monosCnt);
+    a->arr = NULL;
 
-    Poly res = addMonosProperty(monosCnt, monos);
+    size_t ptr = monosCnt;
+    size_t ptrA = a->size;
+    size_t ptrB = b->size;
 
-    safeFree((void **) &monos);
-    safeFree((void **) &a->arr);
-    safeFree((void **) &b->arr);
+    while (ptrB > 0) {
+        if (ptrA > 0 && monos[ptrA - 1].exp < b->arr[ptrB - 1].exp)
+            monos[--ptr] = monos[--ptrA];
+        else
+            monos[--ptr] = b->arr[--ptrB];
+    }
 
-    return res;
+    monosFree(&b->arr);
+
+    return addMonosProperty(monosCnt, monos);
 }
 
 /**
@@ -286,9 +802,11 @@ static Poly addPropertyNonCoeffs(Poly *a, Poly *b) {
  * Dodanie wielomianu
  * @f$p(x_0) = \sum\limits_{i\in\mathbb{I}} x_0^i\cdot p_{0,i}(x_1)@f$
  * oraz wielomianu @f$q(x_0)=c@f$, gdzie @f$c\in\mathbb{Z}@f$.
+ * Stała dodawana jest do ostatniego jednomianu, o ile ma on wykładnik 0,
+ * a w przeciwnym razie dopisywana jest na końcu tablicy.
  * Wartości przyjmowane są na własność.
- * @param[in] a : wielomian @f$p@f$
- * @param[in] b : wielomian @f$q@f$
+ * @param[in] a : wielomian @f$q@f$
+ * @param[in] b : wielomian @f$p@f$
  * @return @f$p+q@f$
  * */
 static Poly addPropertyCoeffNonCoeff(Poly *a, Poly *b) {
@@ -297,10 +815,24 @@ static Poly addPropertyCoeffNonCoeff(Poly *a, Poly *b) {
     if (PolyIsZero(a))
         return *b;
 
-    Poly tempPoly = { .size = 1, .arr = safeMalloc(sizeof(Mono)) };
-    tempPoly.arr[0] = MonoFromPoly(a, 0);
+    Poly res = *b;
+    monosMakeUnique(&res);
+    Mono *last = &res.arr[res.size - 1];
+
+    if (MonoGetExp(last) == 0) {
+        last->p = PolyAddProperty(&last->p, a);
+
+        if (PolyIsZero(&last->p))
+            res.size--;
+    }
+    else {
+        res.arr = monosRealloc(res.arr, res.size + 1);
+        res.arr[res.size++] = MonoFromPoly(a, 0);
+    }
 
-    return addPropertyNonCoeffs(&tempPoly, b);
+    assert(hasProperForm(&res));
+    polyDeg(&res);
+    return polyIntern(res);
 }
 
 Poly PolyAddProperty(Poly *a, Poly *b) {
@@ -322,61 +854,33 @@ Poly PolyAddProperty(Poly *a, Poly *b) {
 /**
  * Dodanie jednomiantów w posortowanej tablicy.
  * Dla posortowanej tablicy zwracany jest wielomian będący matematyczną sumą
- * tych jednomianów. Jenomiany NIE mogą być zerowe. Jednomiany w przekazanej
- * tablicy moga ulec zmianie.
+ * tych jednomianów. Jednomiany zerowe są pomijane. Tablica zaalokowana na
+ * stercie przyjmowana jest na własność: jednomiany są scalane w miejscu
+ * w jednym przebiegu, a tablica staje się tablicą wyniku lub jest zwalniana.
  * @param[in] count : liczba jednomianów w tablicy
  * @param[in] monos : tablica jednomianów
  * @return wielomian będący sumą jednomianów
  * */
-// already sorted descending, no zero polys
 static Poly addMonosProperty(size_t count, Mono monos[]) {
-    size_t uniqueExp = count;
-    bool *isOk = safeCalloc(count, sizeof(bool));
-    for (size_t i = 0; i < count; ++i)
-        isOk[i] = true;
+    size_t uniqueExp = 0;
 
-    for (size_t i = 1; i < count; ++i) {
-        if (isOk[i] && isOk[i - 1]) {
-            if (monos[i].exp == monos[i - 1].exp) {
-                monos[i].p = PolyAddProperty(&monos[i].p, &monos[i - 1].p);
+    for (size_t i = 0; i < count; ++i) {
+        if (PolyIsZero(&monos[i].p))
+            continue;
 
-                isOk[i - 1] = false;
-                --uniqueExp;
+        if (uniqueExp > 0 && monos[uniqueExp - 1].exp == monos[i].exp) {
+            Mono *last = &monos[uniqueExp - 1];
+            last->p = PolyAddProperty(&last->p, &monos[i].p);
 
-                if (PolyIsZero(&monos[i].p)) {
-                    isOk[i] = false;
-                    --uniqueExp;
-                }
-            }
+            if (PolyIsZero(&last->p))
+                --uniqueExp;
+        }
+        else {
+            monos[uniqueExp++] = monos[i];
         }
     }
 
-    Poly res;
-    bool isSet = false;
-
-    if (uniqueExp == 0) {
-        isSet = true;
-        res = PolyZero();
-    }
-
-    if (uniqueExp == 1)
-        for (size_t i = 0; i < count; ++i)
-            if (monos[i].exp == 0 && canMonoBeCut(&monos[i]) && isOk[i])
-                isSet = true, res = monos[i].p;
-
-    if (!isSet) {
-        res = (Poly) {.size = uniqueExp, .arr = safeCalloc(uniqueExp,
-                                                           sizeof(Mono))};
-        size_t ptr = 0;
-
-        for (size_t i = 0; i < count; ++i)
-            if (isOk[i])
-                res.arr[ptr++] = monos[i];
-    }
-
-    safeFree((void **) &isOk);
-
-    return res;
+    return polyFromUniqueMonos(uniqueExp, monos);
 }
 
 /**
@@ -400,26 +904,19 @@ static Mono monoDeepClone(Mono m) {
 /**
  * Dodanie jednomiantów z tablicy.
  * Dla tablicy zwracany jest wielomian będący matematyczną sumą
- * tych jednomianów. Jenomiany MOGĄ być zerowe. Jednomiany w przekazanej
- * tablicy moga ulec zmianie. Jeżeli tablica nie jest posortowana należy ustawić
- * flagę sort na wartość true, aby funkcja zadziałała poprawnie.
+ * tych jednomianów. Jenomiany MOGĄ być zerowe. Tablica zaalokowana na stercie
+ * przyjmowana jest na własność. Jeżeli tablica nie jest posortowana należy
+ * ustawić flagę sort na wartość true, aby funkcja zadziałała poprawnie.
  * @param[in] count : liczba jednomianów w tablicy
  * @param[in] monos : tablica jednomianów
  * @param[in] sort  : czy tablica ma zostać posortowana
  * @return wielomian będący sumą jednomianów
  * */
 static Poly polyAddMonosPropertySort(size_t count, Mono *monos, bool sort) {
-    size_t countCpy = 0;
-
-    for (size_t i = 0; i < count; ++i)
-        if (!PolyIsZero(&monos[i].p))
-            monos[countCpy++] = monos[i];
-
     if (sort)
-        sortMonosByExp(monos, countCpy);
+        sortMonosByExp(monos, count);
 
-    Poly res = addMonosProperty(countCpy, monos);
-    return res;
+    return addMonosProperty(count, monos);
 }
 
 /**
@@ -435,15 +932,12 @@ static Poly polyAddMonosPropertySort(size_t count, Mono *monos, bool sort) {
  * @return wielomian będący sumą jednomianów
  * */
 static Poly polyAddMonosOptSort(size_t count, const Mono monos[], bool sort, Mono (*f)(Mono)) {
-    Mono *monosCpy = safeCalloc(count, sizeof(Mono));
+    Mono *monosCpy = monosAlloc(count);
 
     for (size_t i = 0; i < count; ++i)
         monosCpy[i] = (*f)(monos[i]);
 
-    Poly res = polyAddMonosPropertySort(count, monosCpy, sort);
-
-    safeFree((void **) &monosCpy);
-    return res;
+    return polyAddMonosPropertySort(count, monosCpy, sort);
 }
 
 /**
@@ -464,14 +958,13 @@ static Poly multConstProperty(Poly *p, poly_coeff_t c) {
     }
 
     if (PolyIsCoeff(p))
-        return PolyFromCoeff(p->coeff * c);
+        return PolyFromCoeff(coeffMul(p->coeff, c));
 
+    monosMakeUnique(p);
     for (size_t i = 0; i < p->size; i++)
         p->arr[i].p = multConstProperty(&p->arr[i].p, c);
 
-    Poly res = polyAddMonosOptSort(p->size, p->arr, false, &monoIdentity);
-    safeFree((void **) &p->arr);
-    return res;
+    return polyAddMonosPropertySort(p->size, p->arr, false);
 }
 
 /**
@@ -482,7 +975,7 @@ static Poly multConstProperty(Poly *p, poly_coeff_t c) {
  * */
 static Poly mulCoeffPoly(const Poly *p, const Poly *q) {
     assert(PolyIsCoeff(p) && PolyIsCoeff(q));
-    return PolyFromCoeff(p->coeff * q->coeff);
+    return PolyFromCoeff(coeffMul(p->coeff, q->coeff));
 }
 
 /**
@@ -497,314 +990,2576 @@ static Poly mulNonCoeffAndCoeffPoly(const Poly *p, const Poly *q) {
     return multConstProperty(&toMultiply, q->coeff);
 }
 
+/** Początkowy rozmiar tablicy jednomianów iloczynu. */
+#define INIT_PRODUCT_SIZE 4
+
+/** Odwrotność minimalnego wypełnienia zakresu kluczy gęstego wielomianu. */
+#define DENSE_FILL_FACTOR 4
+
+/** Minimalna liczba iloczynów wyrazów, od której mnożenie jest równoległe. */
+#define PARALLEL_MUL_MIN_WORK (1 << 16)
+
+/** Liczba zadań mnożenia równoległego przypadająca na jeden wątek. */
+#define PARALLEL_TASKS_PER_THREAD 4
+
+/**
+ * Element kopca używanego przy mnożeniu wielomianów.
+ * Reprezentuje iloczyn jednomianu o indeksie @p row krótszego czynnika
+ * i jednomianu o indeksie @p col dłuższego czynnika.
+ * */
+typedef struct {
+    poly_exp_t exp; ///< wykładnik iloczynu jednomianów
+    size_t row; ///< indeks jednomianu w krótszym czynniku
+    size_t col; ///< indeks jednomianu w dłuższym czynniku
+} MulHeapElem;
+
+/**
+ * Strumień jednomianów iloczynu dwóch wielomianów niestałych.
+ * Kopiec zawiera dla każdego jednomianu krótszego czynnika co najwyżej jeden
+ * element wskazujący na kolejny, jeszcze niewyliczony iloczyn. Jednomiany
+ * iloczynu wydawane są w kolejności malejących wykładników, a jednomiany
+ * o równych wykładnikach są od razu sumowane.
+ * */
+typedef struct {
+    const Poly *rows; ///< krótszy czynnik
+    const Poly *cols; ///< dłuższy czynnik
+    MulHeapElem *heap; ///< kopiec typu max po wykładnikach
+    size_t heapSize; ///< liczba elementów kopca
+} MulStream;
+
+/**
+ * Przywrócenie własności kopca w dół od zadanego elementu.
+ * @param[in,out] heap : kopiec
+ * @param[in] size : rozmiar kopca
+ * @param[in] idx : indeks naprawianego elementu
+ * */
+static inline void mulHeapSiftDown(MulHeapElem *heap, size_t size, size_t idx) {
+    MulHeapElem elem = heap[idx];
+
+    while (2 * idx + 1 < size) {
+        size_t child = 2 * idx + 1;
+        if (child + 1 < size && heap[child + 1].exp > heap[child].exp)
+            child++;
+
+        if (heap[child].exp <= elem.exp)
+            break;
+
+        heap[idx] = heap[child];
+        idx = child;
+    }
+
+    heap[idx] = elem;
+}
+
 /**
- * Mnożenie dwóch wielomianów niestałych.
+ * Utworzenie strumienia jednomianów iloczynu @f$p\cdot q@f$.
+ * Wiersze kopca odpowiadają krótszemu z czynników, więc kopiec ma rozmiar
+ * @f$\min(|p|, |q|)@f$.
  * @param[in] p : wielomian niestały @f$p@f$
  * @param[in] q : wielomian niestały @f$q@f$
- * @return @f$p\cdot q@f$
+ * @return strumień jednomianów iloczynu
  * */
-static Poly mulTwoNonCoeffPoly(const Poly *p, const Poly *q) {
+static MulStream mulStreamInit(const Poly *p, const Poly *q) {
     assert(!PolyIsCoeff(p) && !PolyIsCoeff(q));
-    assert(isSorted(p) && isSorted(q));
-
-    size_t ws = 0, allSize = p->size * q->size;
-    Mono *allMonos = safeCalloc(allSize, sizeof(Mono));
 
-    for (size_t i = 0; i < p->size; i++) {
-        for (size_t j = 0; j < q->size; j++) {
-            allMonos[ws].p = PolyMul(&p->arr[i].p, &q->arr[j].p);
-            allMonos[ws].exp = p->arr[i].exp + q->arr[j].exp;
-            ws++;
-        }
+    MulStream s;
+    s.rows = (p->size <= q->size) ? p : q;
+    s.cols = (p->size <= q->size) ? q : p;
+    s.heapSize = s.rows->size;
+    s.heap = safeCalloc(s.heapSize, sizeof(MulHeapElem));
+
+    // Pierwsza kolumna jest posortowana malejąco, więc jest już kopcem.
+    for (size_t i = 0; i < s.heapSize; ++i) {
+        s.heap[i].row = i;
+        s.heap[i].col = 0;
+        s.heap[i].exp = s.rows->arr[i].exp + s.cols->arr[0].exp;
     }
 
-    Poly s = PolyAddMonos(allSize, allMonos);
-
-    safeFree((void **) &allMonos);
     return s;
 }
 
 /**
- * Pomocnicza funkcja do obliczania stopnia wielomianu.
- * Funkcja wywołuje się rekurencyjnie, aż do odpowiedniego poziomu,
- * gdzie poprawia wynik zapisany w zmiennej.
- * @param[in] p : wielomian @f$p@f$, którego stopień sprawdzamy
- * @param[in] actIdx : aktualna zmienna @f$x_{actIdx}@f$
- * @param[in] varIdx : szukana zmienna
- * @param[out] acc : wskaźnik na zmienną z wynikiem
- * @return stopień wielomianu @f$p@f$ po zmiennej @f$x_{varIdx}@f$
+ * Dodanie do sumy wszystkich iloczynów jednomianów o największym
+ * pozostałym wykładniku.
+ * Iloczyny współczynników dodawane są do sumy przez PolyMulAddProperty(),
+ * więc nie powstają pośrednie iloczyny.
+ * @param[in,out] s : niepusty strumień jednomianów iloczynu
+ * @param[in] sum : suma, przyjmowana na własność
+ * @return suma powiększona o współczynnik jednomianu iloczynu
  * */
-static void degBy(const Poly *p, size_t actIdx, size_t varIdx, poly_exp_t *acc) {
-    assert(hasProperForm(p));
+static Poly mulStreamAccumulate(MulStream *s, Poly sum) {
+    poly_exp_t exp = s->heap[0].exp;
 
-    if (PolyIsCoeff(p))
-        return;
+    while (s->heapSize > 0 && s->heap[0].exp == exp) {
+        MulHeapElem *top = &s->heap[0];
+        sum = PolyMulAddProperty(&sum, &s->rows->arr[top->row].p,
+                                 &s->cols->arr[top->col].p);
 
-    if (actIdx == varIdx) {
-        // jednomiany są posortowane, więc pierwszy na największy wykładnik
-        *acc = max(*acc, MonoGetExp(&p->arr[0]));
-    }
-    else {
-        for (size_t i = 0; i < p->size; ++i) {
-            degBy(&p->arr[i].p, actIdx + 1, varIdx, acc);
-        }
+        if (++top->col < s->cols->size)
+            top->exp = s->rows->arr[top->row].exp
+                       + s->cols->arr[top->col].exp;
+        else
+            s->heap[0] = s->heap[--s->heapSize];
+
+        mulHeapSiftDown(s->heap, s->heapSize, 0);
     }
+
+    return sum;
+}
+
+/**
+ * Wyznaczenie kolejnego jednomianu iloczynu.
+ * Sumuje wszystkie iloczyny jednomianów o największym pozostałym wykładniku.
+ * Jednomiany o zerowym współczynniku są pomijane.
+ * @param[in,out] s : strumień jednomianów iloczynu
+ * @param[out] out : kolejny jednomian iloczynu
+ * @return czy wyznaczono kolejny jednomian
+ * */
+static bool mulStreamNext(MulStream *s, Mono *out) {
+    while (s->heapSize > 0) {
+        poly_exp_t exp = s->heap[0].exp;
+        Poly sum = mulStreamAccumulate(s, PolyZero());
+
+        if (!PolyIsZero(&sum)) {
+            *out = (Mono) {.p = sum, .exp = exp};
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Usunięcie strumienia jednomianów iloczynu z pamięci.
+ * @param[in,out] s : strumień jednomianów iloczynu
+ * */
+static void mulStreamDestroy(MulStream *s) {
+    safeFree((void **) &s->heap);
+}
+
+/**
+ * Mnożenie dwóch wielomianów niestałych metodą kopcową.
+ * Jednomiany iloczynu wyznaczane są kopcem w kolejności malejących
+ * wykładników i od razu sumowane, więc w pamięci znajduje się jedynie
+ * wynik i kopiec rozmiaru @f$\min(|p|, |q|)@f$.
+ * @param[in] p : wielomian niestały @f$p@f$
+ * @param[in] q : wielomian niestały @f$q@f$
+ * @return @f$p\cdot q@f$
+ * */
+static Poly mulHeapNonCoeffPoly(const Poly *p, const Poly *q) {
+    assert(!PolyIsCoeff(p) && !PolyIsCoeff(q));
+    assert(isSorted(p) && isSorted(q));
+
+    MulStream stream = mulStreamInit(p, q);
+
+    size_t count = 0, memSize = INIT_PRODUCT_SIZE;
+    Mono *monos = monosAlloc(memSize);
+    Mono m;
+
+    while (mulStreamNext(&stream, &m)) {
+        if (count == memSize) {
+            memSize <<= 1;
+            monos = monosRealloc(monos, memSize);
+        }
+
+        monos[count++] = m;
+    }
+
+    mulStreamDestroy(&stream);
+    return polyFromUniqueMonos(count, monos);
+}
+
+/**
+ * Układ podstawienia Kroneckera.
+ * Wektor wykładników @f$(e_0, \ldots, e_{d-1})@f$ kodowany jest jako klucz
+ * @f$\sum_l e_l\cdot stride_l@f$, gdzie @f$stride_l@f$ jest iloczynem
+ * podstaw @f$base_{l+1}\cdots base_{d-1}@f$. Porządek malejących kluczy
+ * jest porządkiem jednomianów w rekurencyjnej reprezentacji wielomianu.
+ * */
+typedef struct {
+    size_t depth; ///< liczba poziomów (zmiennych)
+    uint64_t *bases; ///< podstawy kolejnych poziomów
+    uint64_t *strides; ///< wagi kolejnych poziomów w kluczu
+} KroneckerLayout;
+
+/**
+ * Wielomian spłaszczony podstawieniem Kroneckera.
+ * Klucze są posortowane malejąco, a współczynniki niezerowe.
+ * */
+typedef struct {
+    size_t size; ///< liczba wyrazów
+    uint64_t *keys; ///< klucze wyrazów
+    poly_coeff_t *coeffs; ///< współczynniki wyrazów
+} FlatPoly;
+
+/**
+ * Pojedynczy wyraz wielomianu spłaszczonego.
+ * */
+typedef struct {
+    uint64_t key; ///< klucz wyrazu
+    poly_coeff_t coeff; ///< współczynnik wyrazu
+} FlatTerm;
+
+/**
+ * Element kopca używanego przy mnożeniu wielomianów spłaszczonych.
+ * */
+typedef struct {
+    uint64_t key; ///< klucz iloczynu wyrazów
+    size_t row; ///< indeks wyrazu w krótszym czynniku
+    size_t col; ///< indeks wyrazu w dłuższym czynniku
+} FlatHeapElem;
+
+/**
+ * Wyznaczenie głębokości wielomianu, czyli liczby jego zmiennych.
+ * @param[in] p : wielomian
+ * @return głębokość wielomianu @f$p@f$ (0 dla wielomianu stałego)
+ * */
+static size_t polyDepth(const Poly *p) {
+    if (PolyIsCoeff(p))
+        return 0;
+
+    LevelDegs *cached = atomic_load_explicit(&monosHeader(p->arr)->levelDegs,
+                                             memory_order_acquire);
+    if (cached != NULL)
+        return cached->depth;
+
+    size_t depth = 0;
+    for (size_t i = 0; i < p->size; ++i) {
+        size_t sub = polyDepth(&p->arr[i].p);
+        if (sub > depth)
+            depth = sub;
+    }
+
+    return depth + 1;
+}
+
+/**
+ * Wyznaczenie największych wykładników na kolejnych poziomach wielomianu.
+ * @param[in] p : wielomian
+ * @param[in] level : aktualny poziom
+ * @param[in,out] degs : tablica największych wykładników
+ * */
+static void polyLevelDegs(const Poly *p, size_t level, poly_exp_t *degs) {
+    if (PolyIsCoeff(p))
+        return;
+
+    LevelDegs *cached = atomic_load_explicit(&monosHeader(p->arr)->levelDegs,
+                                             memory_order_acquire);
+    if (cached != NULL) {
+        for (size_t l = 0; l < cached->depth; ++l)
+            degs[level + l] = max(degs[level + l], cached->degs[l]);
+        return;
+    }
+
+    degs[level] = max(degs[level], MonoGetExp(&p->arr[0]));
+
+    for (size_t i = 0; i < p->size; ++i)
+        polyLevelDegs(&p->arr[i].p, level + 1, degs);
+}
+
+/**
+ * Największe wykładniki na kolejnych poziomach wielomianu niestałego.
+ * Wynik wyznaczany jest przy pierwszym wywołaniu i zapisywany w nagłówku
+ * tablicy jednomianów do czasu jej modyfikacji.
+ * @param[in] p : wielomian niestały
+ * @return największe wykładniki, ważne tak długo jak tablica @f$p@f$
+ * */
+static const LevelDegs *polyLevels(const Poly *p) {
+    assert(!PolyIsCoeff(p));
+
+    MonosHeader *header = monosHeader(p->arr);
+    LevelDegs *levels = atomic_load_explicit(&header->levelDegs,
+                                             memory_order_acquire);
+    if (levels != NULL)
+        return levels;
+
+    size_t depth = polyDepth(p);
+    levels = safeMalloc(sizeof(LevelDegs) + depth * sizeof(poly_exp_t));
+    levels->depth = depth;
+    for (size_t l = 0; l < depth; ++l)
+        levels->degs[l] = 0;
+    polyLevelDegs(p, 0, levels->degs);
+
+    // Wielomian może być jednocześnie odczytywany przez kilka wątków.
+    LevelDegs *expected = NULL;
+    if (!atomic_compare_exchange_strong_explicit(&header->levelDegs,
+                                                 &expected, levels,
+                                                 memory_order_acq_rel,
+                                                 memory_order_acquire)) {
+        free(levels);
+        levels = expected;
+    }
+
+    return levels;
+}
+
+/**
+ * Wyznaczenie układu podstawienia Kroneckera dla zadanych stopni.
+ * Podstawa poziomu to jego największy wykładnik powiększony o jeden.
+ * @param[in] depth : liczba poziomów
+ * @param[in] degs : największe wykładniki na kolejnych poziomach
+ * @param[out] layout : wyznaczony układ
+ * @return czy klucze mieszczą się w 64 bitach
+ * */
+static bool kroneckerLayoutBuild(size_t depth, const uint64_t *degs,
+                                 KroneckerLayout *layout) {
+    layout->depth = depth;
+    layout->bases = safeCalloc(depth, sizeof(uint64_t));
+    layout->strides = safeCalloc(depth, sizeof(uint64_t));
+
+    bool fits = true;
+    uint64_t stride = 1;
+
+    for (size_t l = depth; l > 0 && fits; --l) {
+        uint64_t deg = degs[l - 1];
+        layout->bases[l - 1] = deg + 1;
+        layout->strides[l - 1] = stride;
+
+        fits = deg <= INT_MAX && stride <= UINT64_MAX / (deg + 1);
+        if (fits)
+            stride *= deg + 1;
+    }
+
+    return fits;
+}
+
+/**
+ * Wyznaczenie układu podstawienia Kroneckera dla iloczynu @f$p\cdot q@f$.
+ * Podstawa poziomu to suma największych wykładników czynników powiększona
+ * o jeden, więc cyfry iloczynu nie przenoszą się między poziomami.
+ * @param[in] p : wielomian niestały @f$p@f$
+ * @param[in] q : wielomian niestały @f$q@f$
+ * @param[out] layout : wyznaczony układ
+ * @return czy klucze iloczynu mieszczą się w 64 bitach
+ * */
+static bool kroneckerLayoutInit(const Poly *p, const Poly *q,
+                                KroneckerLayout *layout) {
+    const LevelDegs *levelsP = polyLevels(p), *levelsQ = polyLevels(q);
+    size_t depth = max(levelsP->depth, levelsQ->depth);
+
+    uint64_t *degs = safeCalloc(depth, sizeof(uint64_t));
+    for (size_t l = 0; l < levelsP->depth; ++l)
+        degs[l] += (uint64_t) levelsP->degs[l];
+    for (size_t l = 0; l < levelsQ->depth; ++l)
+        degs[l] += (uint64_t) levelsQ->degs[l];
+
+    bool fits = kroneckerLayoutBuild(depth, degs, layout);
+
+    safeFree((void **) &degs);
+
+    return fits;
+}
+
+/**
+ * Usunięcie układu podstawienia Kroneckera z pamięci.
+ * @param[in,out] layout : układ
+ * */
+static void kroneckerLayoutDestroy(KroneckerLayout *layout) {
+    safeFree((void **) &layout->bases);
+    safeFree((void **) &layout->strides);
+}
+
+/**
+ * Liczba wyrazów wielomianu po spłaszczeniu.
+ * @param[in] p : wielomian
+ * @return liczba współczynników stałych w drzewie wielomianu
+ * */
+static size_t polyTermCount(const Poly *p) {
+    if (PolyIsCoeff(p))
+        return 1;
+
+    size_t count = 0;
+    for (size_t i = 0; i < p->size; ++i)
+        count += polyTermCount(&p->arr[i].p);
+
+    return count;
+}
+
+/**
+ * Liczba wyrazów wielomianu po spłaszczeniu, ograniczona z góry.
+ * Przejście kończy się, gdy tylko liczba wyrazów osiągnie ograniczenie,
+ * więc koszt nie zależy od wielkości dużych wielomianów.
+ * @param[in] p : wielomian
+ * @param[in] limit : ograniczenie, dodatnie
+ * @return min(liczba współczynników stałych w drzewie wielomianu, limit)
+ * */
+static size_t polyTermCountUpTo(const Poly *p, size_t limit) {
+    if (PolyIsCoeff(p))
+        return 1;
+
+    size_t count = 0;
+    for (size_t i = 0; i < p->size && count < limit; ++i)
+        count += polyTermCountUpTo(&p->arr[i].p, limit - count);
+
+    return count;
+}
+
+/**
+ * Spłaszczenie wielomianu do tablic kluczy i współczynników.
+ * Przejście w głąb odwiedza wyrazy w porządku malejących kluczy.
+ * @param[in] p : wielomian
+ * @param[in] level : aktualny poziom
+ * @param[in] prefix : klucz wyznaczony przez wykładniki wyższych poziomów
+ * @param[in] layout : układ podstawienia
+ * @param[in,out] flat : uzupełniany wielomian spłaszczony
+ * */
+static void polyFlattenInto(const Poly *p, size_t level, uint64_t prefix,
+                            const KroneckerLayout *layout, FlatPoly *flat) {
+    if (PolyIsCoeff(p)) {
+        flat->keys[flat->size] = prefix;
+        flat->coeffs[flat->size] = p->coeff;
+        flat->size++;
+        return;
+    }
+
+    for (size_t i = 0; i < p->size; ++i) {
+        uint64_t key = prefix
+                       + (uint64_t) MonoGetExp(&p->arr[i]) * layout->strides[level];
+        polyFlattenInto(&p->arr[i].p, level + 1, key, layout, flat);
+    }
+}
+
+/**
+ * Spłaszczenie wielomianu podstawieniem Kroneckera.
+ * @param[in] p : wielomian niestały
+ * @param[in] layout : układ podstawienia
+ * @return wielomian spłaszczony
+ * */
+static FlatPoly polyFlatten(const Poly *p, const KroneckerLayout *layout) {
+    size_t count = polyTermCount(p);
+    FlatPoly flat = {.size = 0,
+                     .keys = safeCalloc(count, sizeof(uint64_t)),
+                     .coeffs = safeCalloc(count, sizeof(poly_coeff_t))};
+
+    polyFlattenInto(p, 0, 0, layout, &flat);
+    return flat;
+}
+
+/**
+ * Usunięcie wielomianu spłaszczonego z pamięci.
+ * @param[in,out] flat : wielomian spłaszczony
+ * */
+static void flatPolyDestroy(FlatPoly *flat) {
+    safeFree((void **) &flat->keys);
+    safeFree((void **) &flat->coeffs);
+}
+
+/**
+ * Porównanie wyrazów malejąco po kluczach.
+ * @param[in] a : pierwszy wyraz
+ * @param[in] b : drugi wyraz
+ * @return wynik porównania dla qsort
+ * */
+static int flatTermCmp(const void *a, const void *b) {
+    uint64_t x = ((const FlatTerm *) a)->key;
+    uint64_t y = ((const FlatTerm *) b)->key;
+    return (x < y) - (x > y);
+}
+
+/**
+ * Złożenie wielomianu spłaszczonego z nieuporządkowanych wyrazów.
+ * Wyrazy są sortowane, wyrazy o równych kluczach sumowane, a wyrazy
+ * o zerowej sumie pomijane.
+ * @param[in,out] terms : wyrazy, sortowane w miejscu
+ * @param[in] count : liczba wyrazów
+ * @return wielomian spłaszczony
+ * */
+static FlatPoly flatFromTerms(FlatTerm *terms, size_t count) {
+    qsort(terms, count, sizeof(FlatTerm), flatTermCmp);
+
+    FlatPoly flat = {.size = 0,
+                     .keys = safeCalloc(count, sizeof(uint64_t)),
+                     .coeffs = safeCalloc(count, sizeof(poly_coeff_t))};
+    bool overflow = false;
+    for (size_t i = 0; i < count;) {
+        uint64_t key = terms[i].key;
+        poly_coeff_t sum = 0;
+        for (; i < count && terms[i].key == key; ++i)
+            sum = coeffAddTrack(sum, terms[i].coeff, &overflow);
+
+        if (sum != 0) {
+            flat.keys[flat.size] = key;
+            flat.coeffs[flat.size] = sum;
+            flat.size++;
+        }
+    }
+    coeffCheck(overflow);
+
+    return flat;
+}
+
+/**
+ * Przywrócenie własności kopca w dół od zadanego elementu.
+ * @param[in,out] heap : kopiec
+ * @param[in] size : rozmiar kopca
+ * @param[in] idx : indeks naprawianego elementu
+ * */
+static inline void flatHeapSiftDown(FlatHeapElem *heap, size_t size, size_t idx) {
+    FlatHeapElem elem = heap[idx];
+
+    while (2 * idx + 1 < size) {
+        size_t child = 2 * idx + 1;
+        if (child + 1 < size && heap[child + 1].key > heap[child].key)
+            child++;
+
+        if (heap[child].key <= elem.key)
+            break;
+
+        heap[idx] = heap[child];
+        idx = child;
+    }
+
+    heap[idx] = elem;
+}
+
+/**
+ * Mnożenie dwóch wielomianów spłaszczonych.
+ * Działa jak mulHeapNonCoeffPoly(), lecz na współczynnikach stałych,
+ * więc nie wywołuje rekurencyjnie PolyMul().
+ * @param[in] a : wielomian spłaszczony
+ * @param[in] b : wielomian spłaszczony
+ * @return iloczyn spłaszczony
+ * */
+static FlatPoly flatMul(const FlatPoly *a, const FlatPoly *b) {
+    const FlatPoly *rows = (a->size <= b->size) ? a : b;
+    const FlatPoly *cols = (a->size <= b->size) ? b : a;
+
+    size_t heapSize = rows->size;
+    FlatHeapElem *heap = safeCalloc(heapSize, sizeof(FlatHeapElem));
+    for (size_t i = 0; i < heapSize; ++i)
+        heap[i] = (FlatHeapElem) {.key = rows->keys[i] + cols->keys[0],
+                                  .row = i, .col = 0};
+
+    size_t memSize = INIT_PRODUCT_SIZE;
+    FlatPoly res = {.size = 0,
+                    .keys = safeCalloc(memSize, sizeof(uint64_t)),
+                    .coeffs = safeCalloc(memSize, sizeof(poly_coeff_t))};
+    bool overflow = false;
+
+    while (heapSize > 0) {
+        uint64_t key = heap[0].key;
+        poly_coeff_t sum = 0;
+
+        while (heapSize > 0 && heap[0].key == key) {
+            FlatHeapElem *top = &heap[0];
+            sum = coeffAddTrack(sum, coeffMulTrack(rows->coeffs[top->row],
+                                                   cols->coeffs[top->col],
+                                                   &overflow),
+                                &overflow);
+
+            if (++top->col < cols->size)
+                top->key = rows->keys[top->row] + cols->keys[top->col];
+            else
+                heap[0] = heap[--heapSize];
+
+            flatHeapSiftDown(heap, heapSize, 0);
+        }
+
+        if (sum == 0)
+            continue;
+
+        if (res.size == memSize) {
+            memSize <<= 1;
+            res.keys = safeRealloc(res.keys, memSize * sizeof(uint64_t));
+            res.coeffs = safeRealloc(res.coeffs, memSize * sizeof(poly_coeff_t));
+        }
+
+        res.keys[res.size] = key;
+        res.coeffs[res.size] = sum;
+        res.size++;
+    }
+
+    coeffCheck(overflow);
+    safeFree((void **) &heap);
+    return res;
+}
+
+/**
+ * Sprawdzenie czy wielomian spłaszczony jest gęsty.
+ * Wielomian jest gęsty, gdy co najmniej co @ref DENSE_FILL_FACTOR klucz
+ * z zakresu jego kluczy jest wyrazem.
+ * @param[in] flat : niepusty wielomian spłaszczony
+ * @return czy wielomian jest gęsty
+ * */
+static bool isFlatDense(const FlatPoly *flat) {
+    uint64_t range = flat->keys[0] - flat->keys[flat->size - 1];
+    return range / DENSE_FILL_FACTOR < flat->size;
+}
+
+/**
+ * Największy moduł i suma modułów współczynników wielomianu spłaszczonego.
+ * @param[in] flat : wielomian spłaszczony
+ * @param[out] max : największy moduł współczynnika
+ * @param[out] sum : suma modułów współczynników
+ * @return czy suma modułów mieści się w unsigned long
+ * */
+static bool flatAbsBounds(const FlatPoly *flat, unsigned long *max,
+                          unsigned long *sum) {
+    bool overflow = false;
+    *max = 0;
+    *sum = 0;
+    for (size_t i = 0; i < flat->size; ++i) {
+        unsigned long c = (unsigned long) flat->coeffs[i];
+        if (flat->coeffs[i] < 0)
+            c = -c;
+        if (c > *max)
+            *max = c;
+        overflow |= __builtin_add_overflow(*sum, c, sum);
+    }
+
+    return !overflow;
+}
+
+/**
+ * Sprawdzenie, czy współczynniki iloczynu na pewno mieszczą się
+ * w poly_coeff_t. Moduł współczynnika iloczynu nie przekracza sumy modułów
+ * współczynników jednego czynnika pomnożonej przez największy moduł
+ * współczynnika drugiego.
+ * @param[in] a : wielomian spłaszczony
+ * @param[in] b : wielomian spłaszczony
+ * @return czy oszacowanie wyklucza przepełnienie
+ * */
+static bool flatMulFits(const FlatPoly *a, const FlatPoly *b) {
+    unsigned long maxA, sumA, maxB, sumB, bound;
+    bool sumsFit = flatAbsBounds(a, &maxA, &sumA);
+    sumsFit &= flatAbsBounds(b, &maxB, &sumB);
+    if (!sumsFit)
+        return false;
+
+    return (!__builtin_mul_overflow(sumA, maxB, &bound) && bound <= LONG_MAX)
+           || (!__builtin_mul_overflow(sumB, maxA, &bound) && bound <= LONG_MAX);
+}
+
+/**
+ * Rozwinięcie wielomianu spłaszczonego do gęstego wektora współczynników.
+ * Indeks w wektorze to klucz pomniejszony o najmniejszy klucz.
+ * @param[in] flat : niepusty wielomian spłaszczony
+ * @param[out] len : długość wektora
+ * @return wektor współczynników
+ * */
+static poly_coeff_t *flatToDense(const FlatPoly *flat, size_t *len) {
+    uint64_t minKey = flat->keys[flat->size - 1];
+    *len = flat->keys[0] - minKey + 1;
+
+    poly_coeff_t *dense = safeCalloc(*len, sizeof(poly_coeff_t));
+    for (size_t i = 0; i < flat->size; ++i)
+        dense[flat->keys[i] - minKey] = flat->coeffs[i];
+
+    return dense;
+}
+
+/**
+ * Zwinięcie gęstego wektora współczynników do wielomianu spłaszczonego.
+ * @param[in] dense : wektor współczynników
+ * @param[in] len : długość wektora
+ * @param[in] minKey : klucz odpowiadający pierwszej pozycji wektora
+ * @return wielomian spłaszczony
+ * */
+static FlatPoly flatFromDense(const poly_coeff_t *dense, size_t len,
+                              uint64_t minKey) {
+    size_t count = 0;
+    for (size_t i = 0; i < len; ++i)
+        if (dense[i] != 0)
+            count++;
+
+    FlatPoly res = {.size = 0,
+                    .keys = safeCalloc(count, sizeof(uint64_t)),
+                    .coeffs = safeCalloc(count, sizeof(poly_coeff_t))};
+
+    for (size_t i = len; i > 0; --i) {
+        if (dense[i - 1] != 0) {
+            res.keys[res.size] = minKey + i - 1;
+            res.coeffs[res.size] = dense[i - 1];
+            res.size++;
+        }
+    }
+
+    return res;
+}
+
+/**
+ * Mnożenie dwóch gęstych wielomianów spłaszczonych.
+ * Wielomiany rozwijane są do wektorów współczynników i mnożone przez
+ * denseMul().
+ * @param[in] a : gęsty wielomian spłaszczony
+ * @param[in] b : gęsty wielomian spłaszczony
+ * @return iloczyn spłaszczony
+ * */
+static FlatPoly flatMulDense(const FlatPoly *a, const FlatPoly *b) {
+    size_t n, m;
+    poly_coeff_t *denseA = flatToDense(a, &n);
+    poly_coeff_t *denseB = flatToDense(b, &m);
+    poly_coeff_t *denseRes = safeCalloc(n + m - 1, sizeof(poly_coeff_t));
+
+    // Przy wykrywaniu przepełnień iloczyn, który może się przepełnić,
+    // wyznaczany jest transformatą odtwarzającą dokładne współczynniki.
+    if (__builtin_expect(!overflowCheckEnabled, 1) || flatMulFits(a, b))
+        denseMul(denseA, n, denseB, m, denseRes);
+    else
+        coeffCheck(denseMulChecked(denseA, n, denseB, m, denseRes));
+
+    uint64_t minKey = a->keys[a->size - 1] + b->keys[b->size - 1];
+    FlatPoly res = flatFromDense(denseRes, n + m - 1, minKey);
+
+    safeFree((void **) &denseA);
+    safeFree((void **) &denseB);
+    safeFree((void **) &denseRes);
+
+    return res;
+}
+
+/**
+ * Mnożenie dwóch wielomianów spłaszczonych z wyborem algorytmu.
+ * Gęste wielomiany mające co najmniej tyle wyrazów, ile wynosi próg
+ * algorytmu Karatsuby, mnożone są na wektorach współczynników.
+ * Pozostałe mnożone są metodą kopcową.
+ * @param[in] a : wielomian spłaszczony
+ * @param[in] b : wielomian spłaszczony
+ * @return iloczyn spłaszczony
+ * */
+static FlatPoly flatMulDispatch(const FlatPoly *a, const FlatPoly *b) {
+    size_t minSize = a->size < b->size ? a->size : b->size;
+
+    if (minSize >= getKaratsubaThreshold() && isFlatDense(a) && isFlatDense(b))
+        return flatMulDense(a, b);
+
+    return flatMul(a, b);
+}
+
+/**
+ * Podnoszenie wielomianu spłaszczonego do kwadratu.
+ * Kopiec zawiera dla każdego wyrazu @f$i@f$ iloczyny z wyrazami
+ * @f$j \geq i@f$, więc każdy iloczyn różnych wyrazów wyliczany jest raz
+ * i podwajany.
+ * @param[in] a : niepusty wielomian spłaszczony
+ * @return kwadrat spłaszczony
+ * */
+static FlatPoly flatSquare(const FlatPoly *a) {
+    size_t heapSize = a->size;
+    FlatHeapElem *heap = safeCalloc(heapSize, sizeof(FlatHeapElem));
+
+    // Przekątna jest posortowana malejąco, więc jest już kopcem.
+    for (size_t i = 0; i < heapSize; ++i)
+        heap[i] = (FlatHeapElem) {.key = 2 * a->keys[i], .row = i, .col = i};
+
+    size_t memSize = INIT_PRODUCT_SIZE;
+    FlatPoly res = {.size = 0,
+                    .keys = safeCalloc(memSize, sizeof(uint64_t)),
+                    .coeffs = safeCalloc(memSize, sizeof(poly_coeff_t))};
+    bool overflow = false;
+
+    while (heapSize > 0) {
+        uint64_t key = heap[0].key;
+        poly_coeff_t diag = 0, cross = 0;
+
+        while (heapSize > 0 && heap[0].key == key) {
+            FlatHeapElem *top = &heap[0];
+            poly_coeff_t prod = coeffMulTrack(a->coeffs[top->row],
+                                              a->coeffs[top->col], &overflow);
+            if (top->row == top->col)
+                diag = coeffAddTrack(diag, prod, &overflow);
+            else
+                cross = coeffAddTrack(cross, prod, &overflow);
+
+            if (++top->col < a->size)
+                top->key = a->keys[top->row] + a->keys[top->col];
+            else
+                heap[0] = heap[--heapSize];
+
+            flatHeapSiftDown(heap, heapSize, 0);
+        }
+
+        poly_coeff_t sum = coeffAddTrack(diag, coeffMulTrack(cross, 2, &overflow),
+                                         &overflow);
+        if (sum == 0)
+            continue;
+
+        if (res.size == memSize) {
+            memSize <<= 1;
+            res.keys = safeRealloc(res.keys, memSize * sizeof(uint64_t));
+            res.coeffs = safeRealloc(res.coeffs, memSize * sizeof(poly_coeff_t));
+        }
+
+        res.keys[res.size] = key;
+        res.coeffs[res.size] = sum;
+        res.size++;
+    }
+
+    coeffCheck(overflow);
+    safeFree((void **) &heap);
+    return res;
+}
+
+/**
+ * Podnoszenie gęstego wielomianu spłaszczonego do kwadratu przez
+ * denseSquare().
+ * @param[in] a : gęsty wielomian spłaszczony
+ * @return kwadrat spłaszczony
+ * */
+static FlatPoly flatSquareDense(const FlatPoly *a) {
+    size_t n;
+    poly_coeff_t *dense = flatToDense(a, &n);
+    poly_coeff_t *denseRes = safeCalloc(2 * n - 1, sizeof(poly_coeff_t));
+
+    if (__builtin_expect(!overflowCheckEnabled, 1) || flatMulFits(a, a))
+        denseSquare(dense, n, denseRes);
+    else
+        coeffCheck(denseMulChecked(dense, n, dense, n, denseRes));
+    FlatPoly res = flatFromDense(denseRes, 2 * n - 1, 2 * a->keys[a->size - 1]);
+
+    safeFree((void **) &dense);
+    safeFree((void **) &denseRes);
+
+    return res;
+}
+
+/**
+ * Podnoszenie wielomianu spłaszczonego do kwadratu z wyborem algorytmu,
+ * jak w flatMulDispatch().
+ * @param[in] a : wielomian spłaszczony
+ * @return kwadrat spłaszczony
+ * */
+static FlatPoly flatSquareDispatch(const FlatPoly *a) {
+    if (a->size >= getKaratsubaThreshold() && isFlatDense(a))
+        return flatSquareDense(a);
+
+    return flatSquare(a);
+}
+
+/**
+ * Odtworzenie rekurencyjnej postaci wielomianu z postaci spłaszczonej.
+ * @param[in] keys : klucze wyrazów posortowane malejąco
+ * @param[in] coeffs : niezerowe współczynniki wyrazów
+ * @param[in] count : liczba wyrazów
+ * @param[in] level : aktualny poziom
+ * @param[in] layout : układ podstawienia
+ * @return wielomian
+ * */
+static Poly polyUnflatten(const uint64_t *keys, const poly_coeff_t *coeffs,
+                          size_t count, size_t level,
+                          const KroneckerLayout *layout) {
+    if (count == 0)
+        return PolyZero();
+
+    if (level == layout->depth) {
+        assert(count == 1);
+        return PolyFromCoeff(coeffs[0]);
+    }
+
+    uint64_t stride = layout->strides[level];
+    uint64_t base = layout->bases[level];
+
+    size_t groups = 0;
+    for (size_t i = 0; i < count; ++i)
+        if (i == 0 || (keys[i] / stride) % base != (keys[i - 1] / stride) % base)
+            groups++;
+
+    Mono *monos = monosAlloc(groups);
+    size_t ptr = 0;
+
+    for (size_t i = 0; i < count;) {
+        uint64_t digit = (keys[i] / stride) % base;
+        size_t j = i + 1;
+        while (j < count && (keys[j] / stride) % base == digit)
+            j++;
+
+        Poly sub = polyUnflatten(keys + i, coeffs + i, j - i, level + 1,
+                                 layout);
+        monos[ptr++] = (Mono) {.p = sub, .exp = (poly_exp_t) digit};
+        i = j;
+    }
+
+    return polyFromUniqueMonos(groups, monos);
+}
+
+/**
+ * Mnożenie dwóch wielomianów niestałych podstawieniem Kroneckera.
+ * Wielomiany są spłaszczane do wielomianów jednej zmiennej o kluczach
+ * 64-bitowych, mnożone bez rekurencji i odtwarzane.
+ * @param[in] p : wielomian niestały @f$p@f$
+ * @param[in] q : wielomian niestały @f$q@f$
+ * @param[in] layout : układ podstawienia, w którym mieści się iloczyn
+ * @return @f$p\cdot q@f$
+ * */
+static Poly mulKroneckerNonCoeffPoly(const Poly *p, const Poly *q,
+                                     const KroneckerLayout *layout) {
+    FlatPoly flatP = polyFlatten(p, layout);
+    FlatPoly flatQ = polyFlatten(q, layout);
+    FlatPoly flatRes = flatMulDispatch(&flatP, &flatQ);
+
+    Poly res = polyUnflatten(flatRes.keys, flatRes.coeffs, flatRes.size, 0,
+                             layout);
+
+    flatPolyDestroy(&flatP);
+    flatPolyDestroy(&flatQ);
+    flatPolyDestroy(&flatRes);
+
+    return res;
+}
+
+/**
+ * Sekwencyjne mnożenie dwóch wielomianów niestałych.
+ * Wielomiany, których iloczyn mieści się w układzie podstawienia
+ * Kroneckera, mnożone są w postaci spłaszczonej. Pozostałe mnożone są
+ * rekurencyjnie przez mulHeapNonCoeffPoly().
+ * @param[in] p : wielomian niestały @f$p@f$
+ * @param[in] q : wielomian niestały @f$q@f$
+ * @return @f$p\cdot q@f$
+ * */
+static Poly mulSequentialNonCoeffPoly(const Poly *p, const Poly *q) {
+    assert(!PolyIsCoeff(p) && !PolyIsCoeff(q));
+
+    KroneckerLayout layout;
+    bool fits = kroneckerLayoutInit(p, q, &layout);
+
+    Poly res;
+    if (fits)
+        res = mulKroneckerNonCoeffPoly(p, q, &layout);
+    else
+        res = mulHeapNonCoeffPoly(p, q);
+
+    kroneckerLayoutDestroy(&layout);
+    return res;
+}
+
+/**
+ * Stan mnożenia równoległego.
+ * Jeden z czynników dzielony jest na kawałki kolejnych jednomianów,
+ * a iloczyny kawałków z drugim czynnikiem sumowane są drzewiasto.
+ * Przy podnoszeniu do kwadratu oba czynniki są tym samym wielomianem.
+ * */
+typedef struct {
+    const Poly *split; ///< czynnik dzielony na kawałki
+    const Poly *other; ///< drugi czynnik
+    size_t chunks; ///< liczba kawałków
+    Poly *partial; ///< iloczyny kawałków, a potem sumy częściowe
+    size_t stride; ///< odległość sumowanych elementów w bieżącym kroku
+} ParallelMul;
+
+/**
+ * Kawałek wielomianu złożony z kolejnych jednomianów.
+ * Tablica kawałka jest nowa, ale jego jednomiany należą do @f$p@f$, więc
+ * wynik może być jedynie odczytywany i usuwany przez polySliceDestroy().
+ * @param[in] p : wielomian niestały
+ * @param[in] start : indeks pierwszego jednomianu
+ * @param[in] len : liczba jednomianów, co najmniej 1
+ * @return kawałek wielomianu @f$p@f$ w postaci znormalizowanej
+ * */
+static Poly polySlice(const Poly *p, size_t start, size_t len) {
+    if (len == 1 && canMonoBeCut(&p->arr[start]))
+        return p->arr[start].p;
+
+    Poly res = {.size = len, .arr = monosAlloc(len)};
+    memcpy(res.arr, p->arr + start, len * sizeof(Mono));
+    return res;
+}
+
+/**
+ * Usunięcie kawałka wielomianu utworzonego przez polySlice().
+ * @param[in,out] slice : kawałek wielomianu
+ * */
+static void polySliceDestroy(Poly *slice) {
+    if (!PolyIsCoeff(slice))
+        monosFree(&slice->arr);
+}
+
+/**
+ * Wyznaczenie iloczynu jednego kawałka w mnożeniu równoległym.
+ * @param[in,out] arg : stan mnożenia równoległego
+ * @param[in] idx : indeks kawałka
+ * */
+static void parallelMulChunk(void *arg, size_t idx) {
+    ParallelMul *mul = arg;
+    size_t start = idx * mul->split->size / mul->chunks;
+    size_t end = (idx + 1) * mul->split->size / mul->chunks;
+
+    Poly slice = polySlice(mul->split, start, end - start);
+    if (PolyIsCoeff(&slice))
+        mul->partial[idx] = PolyMul(&slice, mul->other);
+    else
+        mul->partial[idx] = mulSequentialNonCoeffPoly(&slice, mul->other);
+
+    polySliceDestroy(&slice);
+}
+
+/**
+ * Jeden krok drzewiastego sumowania iloczynów częściowych.
+ * @param[in,out] arg : stan mnożenia równoległego
+ * @param[in] idx : indeks pary sumowanych elementów
+ * */
+static void parallelMulReduce(void *arg, size_t idx) {
+    ParallelMul *mul = arg;
+    size_t i = 2 * idx * mul->stride;
+
+    if (i + mul->stride < mul->chunks)
+        mul->partial[i] = PolyAddProperty(&mul->partial[i],
+                                          &mul->partial[i + mul->stride]);
+}
+
+/**
+ * Równoległe mnożenie dwóch wielomianów niestałych.
+ * Czynnik o większej liczbie jednomianów dzielony jest na kawałki
+ * mnożone niezależnie w puli wątków. Iloczyny sumowane są w ustalonym
+ * porządku drzewa, więc wynik nie zależy od przeplotu wątków.
+ * @param[in] p : wielomian niestały @f$p@f$
+ * @param[in] q : wielomian niestały @f$q@f$
+ * @return @f$p\cdot q@f$
+ * */
+static Poly mulParallelNonCoeffPoly(const Poly *p, const Poly *q) {
+    ParallelMul mul;
+    mul.split = (p->size >= q->size) ? p : q;
+    mul.other = (p->size >= q->size) ? q : p;
+    mul.chunks = threadPoolThreads() * PARALLEL_TASKS_PER_THREAD;
+    if (mul.chunks > mul.split->size)
+        mul.chunks = mul.split->size;
+    mul.partial = safeCalloc(mul.chunks, sizeof(Poly));
+
+    threadPoolFor(mul.chunks, parallelMulChunk, &mul);
+
+    for (mul.stride = 1; mul.stride < mul.chunks; mul.stride *= 2) {
+        size_t pairs = (mul.chunks + 2 * mul.stride - 1) / (2 * mul.stride);
+        threadPoolFor(pairs, parallelMulReduce, &mul);
+    }
+
+    Poly res = mul.partial[0];
+    safeFree((void **) &mul.partial);
+    return res;
+}
+
+static Poly polySquare(const Poly *p);
+
+/**
+ * Podnoszenie wielomianu niestałego do kwadratu metodą kopcową.
+ * Działa jak mulHeapNonCoeffPoly(), lecz kopiec zawiera dla każdego
+ * jednomianu @f$i@f$ jedynie iloczyny z jednomianami @f$j \geq i@f$.
+ * Iloczyny różnych jednomianów sumowane są osobno i podwajane, a kwadraty
+ * jednomianów wyliczane są rekurencyjnie przez polySquare().
+ * @param[in] p : wielomian niestały @f$p@f$
+ * @return @f$p^2@f$
+ * */
+static Poly squareHeapNonCoeffPoly(const Poly *p) {
+    assert(!PolyIsCoeff(p) && isSorted(p));
+
+    size_t heapSize = p->size;
+    MulHeapElem *heap = safeCalloc(heapSize, sizeof(MulHeapElem));
+    for (size_t i = 0; i < heapSize; ++i)
+        heap[i] = (MulHeapElem) {.exp = 2 * p->arr[i].exp, .row = i, .col = i};
+
+    size_t count = 0, memSize = INIT_PRODUCT_SIZE;
+    Mono *monos = monosAlloc(memSize);
+
+    while (heapSize > 0) {
+        poly_exp_t exp = heap[0].exp;
+        Poly diag = PolyZero(), cross = PolyZero();
+
+        while (heapSize > 0 && heap[0].exp == exp) {
+            MulHeapElem *top = &heap[0];
+            if (top->row == top->col) {
+                Poly square = polySquare(&p->arr[top->row].p);
+                diag = PolyAddProperty(&diag, &square);
+            }
+            else {
+                cross = PolyMulAddProperty(&cross, &p->arr[top->row].p,
+                                           &p->arr[top->col].p);
+            }
+
+            if (++top->col < p->size)
+                top->exp = p->arr[top->row].exp + p->arr[top->col].exp;
+            else
+                heap[0] = heap[--heapSize];
+
+            mulHeapSiftDown(heap, heapSize, 0);
+        }
+
+        cross = multConstProperty(&cross, 2);
+        Poly sum = PolyAddProperty(&diag, &cross);
+        if (PolyIsZero(&sum))
+            continue;
+
+        if (count == memSize) {
+            memSize <<= 1;
+            monos = monosRealloc(monos, memSize);
+        }
+
+        monos[count++] = (Mono) {.p = sum, .exp = exp};
+    }
+
+    safeFree((void **) &heap);
+    return polyFromUniqueMonos(count, monos);
+}
+
+/**
+ * Podnoszenie wielomianu do kwadratu.
+ * Wielomiany, których kwadrat mieści się w układzie podstawienia
+ * Kroneckera, podnoszone są w postaci spłaszczonej przez
+ * flatSquareDispatch(). Pozostałe podnoszone są metodą kopcową.
+ * @param[in] p : wielomian @f$p@f$
+ * @return @f$p^2@f$
+ * */
+static Poly polySquare(const Poly *p) {
+    if (PolyIsCoeff(p))
+        return PolyFromCoeff(coeffMul(p->coeff, p->coeff));
+
+    KroneckerLayout layout;
+    bool fits = kroneckerLayoutInit(p, p, &layout);
+
+    Poly res;
+    if (fits) {
+        FlatPoly flat = polyFlatten(p, &layout);
+        FlatPoly flatRes = flatSquareDispatch(&flat);
+        res = polyUnflatten(flatRes.keys, flatRes.coeffs, flatRes.size, 0,
+                            &layout);
+        flatPolyDestroy(&flat);
+        flatPolyDestroy(&flatRes);
+    }
+    else {
+        res = squareHeapNonCoeffPoly(p);
+    }
+
+    kroneckerLayoutDestroy(&layout);
+    return res;
+}
+
+/**
+ * Początek kawałka w równoległym podnoszeniu do kwadratu.
+ * Jednomian @f$i@f$ mnożony jest przez @f$n - i@f$ jednomianów, więc
+ * granice kawałków wybierane są tak, by każdy zawierał podobną liczbę
+ * iloczynów: @f$n - start_k \approx n\sqrt{1 - k / chunks}@f$.
+ * @param[in] n : liczba jednomianów
+ * @param[in] chunks : liczba kawałków
+ * @param[in] idx : indeks kawałka, nie większy niż @p chunks
+ * @return indeks pierwszego jednomianu kawałka
+ * */
+static size_t squareChunkStart(size_t n, size_t chunks, size_t idx) {
+    if (idx == 0 || idx >= chunks)
+        return idx == 0 ? 0 : n;
+
+    uint64_t target = (uint64_t) n * n / chunks * (chunks - idx);
+
+    // Pierwiastek całkowity metodą Newtona, od góry.
+    uint64_t root = n;
+    while (root > 0 && root * root > target)
+        root = (root + target / root) / 2;
+
+    return n - (size_t) root;
+}
+
+/**
+ * Wyznaczenie jednego kawałka równoległego podnoszenia do kwadratu.
+ * Dla kawałka @f$S_k@f$ i jednomianów @f$T_k@f$ za nim wyliczane jest
+ * @f$S_k^2 + 2 S_k T_k@f$. Suma tych wyrażeń po wszystkich kawałkach
+ * jest równa @f$p^2@f$.
+ * @param[in,out] arg : stan mnożenia równoległego
+ * @param[in] idx : indeks kawałka
+ * */
+static void parallelSquareChunk(void *arg, size_t idx) {
+    ParallelMul *mul = arg;
+    size_t n = mul->split->size;
+    size_t start = squareChunkStart(n, mul->chunks, idx);
+    size_t end = squareChunkStart(n, mul->chunks, idx + 1);
+
+    if (start == end) {
+        mul->partial[idx] = PolyZero();
+        return;
+    }
+
+    Poly slice = polySlice(mul->split, start, end - start);
+    Poly res = polySquare(&slice);
+
+    if (end < n) {
+        Poly tail = polySlice(mul->split, end, n - end);
+        Poly cross;
+        if (PolyIsCoeff(&slice) || PolyIsCoeff(&tail))
+            cross = PolyMul(&slice, &tail);
+        else
+            cross = mulSequentialNonCoeffPoly(&slice, &tail);
+
+        cross = multConstProperty(&cross, 2);
+        res = PolyAddProperty(&res, &cross);
+        polySliceDestroy(&tail);
+    }
+
+    polySliceDestroy(&slice);
+    mul->partial[idx] = res;
+}
+
+/**
+ * Równoległe podnoszenie wielomianu niestałego do kwadratu.
+ * Działa jak mulParallelNonCoeffPoly(), lecz kawałek mnożony jest jedynie
+ * przez siebie i jednomiany za nim, więc każdy iloczyn różnych
+ * jednomianów wyliczany jest raz.
+ * @param[in] p : wielomian niestały @f$p@f$
+ * @return @f$p^2@f$
+ * */
+static Poly squareParallelNonCoeffPoly(const Poly *p) {
+    ParallelMul mul;
+    mul.split = p;
+    mul.other = p;
+    mul.chunks = threadPoolThreads() * PARALLEL_TASKS_PER_THREAD;
+    if (mul.chunks > p->size)
+        mul.chunks = p->size;
+    mul.partial = safeCalloc(mul.chunks, sizeof(Poly));
+
+    threadPoolFor(mul.chunks, parallelSquareChunk, &mul);
+
+    for (mul.stride = 1; mul.stride < mul.chunks; mul.stride *= 2) {
+        size_t pairs = (mul.chunks + 2 * mul.stride - 1) / (2 * mul.stride);
+        threadPoolFor(pairs, parallelMulReduce, &mul);
+    }
+
+    Poly res = mul.partial[0];
+    safeFree((void **) &mul.partial);
+    return res;
+}
+
+/**
+ * Sprawdzenie, czy czynniki iloczynu są równe.
+ * Kopie współdzielące pamięć i wielomiany internowane mają wspólną tablicę
+ * jednomianów. Pozostałe różne czynniki odrzucane są zwykle przez porównanie
+ * liczby jednomianów, skrajnych wykładników i zapisanych w nagłówkach
+ * stopni, zanim PolyIsEq() przejdzie całe drzewa.
+ * @param[in] p : wielomian niestały @f$p@f$
+ * @param[in] q : wielomian niestały @f$q@f$
+ * @return czy @f$p = q@f$
+ * */
+static bool mulFactorsEq(const Poly *p, const Poly *q) {
+    if (p->arr == q->arr)
+        return true;
+
+    if (p->size != q->size
+        || MonoGetExp(&p->arr[0]) != MonoGetExp(&q->arr[0])
+        || MonoGetExp(&p->arr[p->size - 1]) != MonoGetExp(&q->arr[q->size - 1])
+        || polyDeg(p) != polyDeg(q))
+        return false;
+
+    return PolyIsEq(p, q);
+}
+
+/**
+ * Mnożenie dwóch wielomianów niestałych.
+ * Równe czynniki, wskazywane tym samym wskaźnikiem lub równe
+ * strukturalnie, podnoszone są do kwadratu, który wylicza każdy iloczyn
+ * różnych jednomianów raz. Gdy pula ma więcej niż jeden wątek, a liczba
+ * iloczynów wyrazów jest duża, mnożenie wykonywane jest równolegle.
+ * W przeciwnym razie sekwencyjnie.
+ * @param[in] p : wielomian niestały @f$p@f$
+ * @param[in] q : wielomian niestały @f$q@f$
+ * @return @f$p\cdot q@f$
+ * */
+static Poly mulTwoNonCoeffPoly(const Poly *p, const Poly *q) {
+    assert(!PolyIsCoeff(p) && !PolyIsCoeff(q));
+
+    bool square = p == q || mulFactorsEq(p, q);
+
+    if (threadPoolThreads() > 1 && (p->size > 1 || q->size > 1)
+        && polyTermCountUpTo(p, PARALLEL_MUL_MIN_WORK)
+           * polyTermCountUpTo(q, PARALLEL_MUL_MIN_WORK)
+           >= PARALLEL_MUL_MIN_WORK)
+        return square ? squareParallelNonCoeffPoly(p)
+                      : mulParallelNonCoeffPoly(p, q);
+
+    return square ? polySquare(p) : mulSequentialNonCoeffPoly(p, q);
 }
 
 void PolyDestroy(Poly *p) {
     if (PolyIsCoeff(p))
         return;
 
-    for (size_t i = 0; i < p->size; ++i)
-        MonoDestroy(&p->arr[i]);
+    if (!monosRelease(p->arr)) {
+        p->arr = NULL;
+        return;
+    }
+
+    for (size_t i = 0; i < p->size; ++i)
+        MonoDestroy(&p->arr[i]);
+
+    monosFree(&p->arr);
+}
+
+Poly PolyClone(const Poly *p) {
+    if (PolyIsCoeff(p))
+        return PolyFromCoeff(p->coeff);
+
+    if (sharingEnabled || interningEnabled) {
+        atomic_fetch_add_explicit(&monosHeader(p->arr)->refs, 1,
+                                  memory_order_relaxed);
+        return *p;
+    }
+
+    Poly res = {.size = p->size, .arr = monosAlloc(p->size)};
+    for (size_t i = 0; i < p->size; ++i) {
+        res.arr[i] = MonoClone(&p->arr[i]);
+    }
+    atomic_init(&monosHeader(res.arr)->deg,
+                atomic_load_explicit(&monosHeader(p->arr)->deg,
+                                     memory_order_relaxed));
+
+    return res;
+}
+
+// Niech p, q będą miały posortowane tablice po współczynnikach malejąco.
+Poly PolyAdd(const Poly *p, const Poly *q) {
+    Poly a = PolyClone(p);
+    Poly b = PolyClone(q);
+
+    return PolyAddProperty(&a, &b);
+}
+
+Poly PolyAddMonos(size_t count, const Mono monos[]) {
+    return polyAddMonosOptSort(count, monos, true, &monoIdentity);
+}
+
+Poly PolyMul(const Poly *p, const Poly *q) {
+    assert(hasProperForm(p) && hasProperForm(q));
+
+    if (PolyIsCoeff(p) && PolyIsCoeff(q)) {
+        return mulCoeffPoly(p, q);
+    }
+    else if (PolyIsCoeff(p) && !PolyIsCoeff(q)) {
+        return mulNonCoeffAndCoeffPoly(q, p);
+    }
+    else if (PolyIsCoeff(q) && !PolyIsCoeff(p)) {
+        return mulNonCoeffAndCoeffPoly(p, q);
+    }
+    else {
+        return mulTwoNonCoeffPoly(p, q);
+    }
+}
+
+/**
+ * Maksymalna liczba iloczynów wyrazów, dla której PolyMulAddProperty()
+ * wylicza iloczyn strumieniem kopcowym. Dla większych czynników szybsze
+ * jest mnożenie przez PolyMul().
+ * */
+#define MUL_ADD_STREAM_MAX_WORK 1024
+
+/**
+ * Dodanie iloczynu dwóch wielomianów niestałych do sumy.
+ * Jednomiany sumy przenoszone są na koniec jej powiększonej tablicy,
+ * a jednomiany wyniku zapisywane są od początku tej samej tablicy,
+ * scalając jednomiany sumy ze strumieniem jednomianów iloczynu. Tablica
+ * powiększana jest dopiero, gdy zapis dogoni odczyt.
+ * @param[in] acc : suma, przyjmowana na własność
+ * @param[in] a : wielomian niestały @f$a@f$
+ * @param[in] b : wielomian niestały @f$b@f$
+ * @return @f$acc + a\cdot b@f$
+ * */
+static Poly mulAddStreamNonCoeff(Poly *acc, const Poly *a, const Poly *b) {
+    size_t rest, cap;
+    Mono *monos;
+
+    if (PolyIsCoeff(acc)) {
+        rest = PolyIsZero(acc) ? 0 : 1;
+        cap = rest + INIT_PRODUCT_SIZE;
+        monos = monosAlloc(cap);
+        if (rest > 0)
+            monos[cap - 1] = (Mono) {.p = *acc, .exp = 0};
+    }
+    else {
+        monosMakeUnique(acc);
+        rest = acc->size;
+        cap = rest + INIT_PRODUCT_SIZE;
+        monos = monosRealloc(acc->arr, cap);
+        memmove(monos + cap - rest, monos, rest * sizeof(Mono));
+    }
+
+    MulStream stream = mulStreamInit(a, b);
+    size_t count = 0;
+
+    while (stream.heapSize > 0 || rest > 0) {
+        Mono *next = (rest > 0) ? &monos[cap - rest] : NULL;
+        Mono out;
+
+        if (stream.heapSize == 0
+            || (next != NULL && next->exp > stream.heap[0].exp)) {
+            out = *next;
+            rest--;
+        }
+        else {
+            out.exp = stream.heap[0].exp;
+            out.p = PolyZero();
+            if (next != NULL && next->exp == out.exp) {
+                out.p = next->p;
+                rest--;
+            }
+
+            out.p = mulStreamAccumulate(&stream, out.p);
+            if (PolyIsZero(&out.p))
+                continue;
+        }
+
+        if (count == cap - rest) {
+            size_t newCap = 2 * cap;
+            monos = monosRealloc(monos, newCap);
+            memmove(monos + newCap - rest, monos + cap - rest,
+                    rest * sizeof(Mono));
+            cap = newCap;
+        }
+
+        monos[count++] = out;
+    }
+
+    mulStreamDestroy(&stream);
+    return polyFromUniqueMonos(count, monos);
+}
+
+Poly PolyMulAddProperty(Poly *acc, const Poly *a, const Poly *b) {
+    assert(hasProperForm(acc) && hasProperForm(a) && hasProperForm(b));
+
+    if (PolyIsZero(a) || PolyIsZero(b))
+        return *acc;
+
+    if (PolyIsCoeff(acc) && PolyIsCoeff(a) && PolyIsCoeff(b))
+        return PolyFromCoeff(coeffAdd(acc->coeff, coeffMul(a->coeff, b->coeff)));
+
+    // Tablica sumy jest scalana w miejscu, więc czynnik współdzielący ją
+    // z sumą zostałby nadpisany w trakcie odczytu.
+    if (PolyIsCoeff(a) || PolyIsCoeff(b)
+        || (!PolyIsCoeff(acc) && (a->arr == acc->arr || b->arr == acc->arr))
+        || a->size * b->size > MUL_ADD_STREAM_MAX_WORK
+        || polyTermCountUpTo(a, MUL_ADD_STREAM_MAX_WORK + 1)
+           * polyTermCountUpTo(b, MUL_ADD_STREAM_MAX_WORK + 1)
+           > MUL_ADD_STREAM_MAX_WORK) {
+        Poly prod = PolyMul(a, b);
+        return PolyAddProperty(acc, &prod);
+    }
+
+    return mulAddStreamNonCoeff(acc, a, b);
+}
+
+void PolySetSharing(bool enabled) {
+    sharingEnabled = enabled;
+}
+
+void PolySetInterning(bool enabled) {
+    interningEnabled = enabled;
+}
+
+void PolySetThreads(size_t threads) {
+    if (threads == 0) {
+        const char *env = getenv(THREADS_ENV_VARIABLE);
+        char *end;
+        threads = (env == NULL) ? 1 : strtoul(env, &end, 10);
+
+        // strtoul przyjmuje też liczby ujemne, zamieniając je na ogromne.
+        if (env != NULL && (*env == '\0' || *end != '\0'
+                            || strchr(env, '-') != NULL
+                            || threads > threadPoolMaxThreads()))
+            threads = 1;
+    }
+
+    threadPoolInit(threads);
+}
+
+void PolySetOverflowCheck(bool enabled) {
+    overflowCheckEnabled = enabled;
+}
+
+bool PolyOverflowCheckEnabled(void) {
+    return overflowCheckEnabled;
+}
+
+bool PolyClearOverflow(void) {
+    return atomic_exchange_explicit(&overflowOccurred, false,
+                                    memory_order_relaxed);
+}
+
+Poly PolyNeg(const Poly *p) {
+    assert(hasProperForm(p));
+    Poly a = PolyClone(p);
+    return PolyNegProperty(&a);
+}
+
+Poly PolyNegProperty(Poly *p) {
+    return multConstProperty(p, -1);
+}
+
+Poly PolySub(const Poly *p, const Poly *q) {
+    Poly qq = PolyNeg(q);
+    Poly res = PolyAdd(p, &qq);
+    PolyDestroy(&qq);
+    return res;
+}
+
+Poly PolySubProperty(Poly *p, Poly *q) {
+    Poly neg = PolyNegProperty(q);
+    return PolyAddProperty(p, &neg);
+}
+
+poly_exp_t PolyDegBy(const Poly *p, size_t varIdx) {
+    assert(hasProperForm(p));
+
+    if (PolyIsZero(p))
+        return -1;
+
+    if (PolyIsCoeff(p))
+        return 0;
+
+    const LevelDegs *levels = polyLevels(p);
+    return varIdx < levels->depth ? levels->degs[varIdx] : 0;
+}
+
+poly_exp_t PolyDeg(const Poly *p) {
+    assert(hasProperForm(p));
+
+    return polyDeg(p);
+}
+
+uint64_t PolyHash(const Poly *p) {
+    assert(hasProperForm(p));
+    return polyHash(p);
+}
+
+bool PolyIsEq(const Poly *p, const Poly *q) {
+    assert(hasProperForm(p) && hasProperForm(q));
+
+    if (PolyIsCoeff(p) ^ PolyIsCoeff(q))
+        return false;
+
+    if (PolyIsCoeff(p) && PolyIsCoeff(q)) {
+        return p->coeff == q->coeff;
+    }
+    else {
+        if (p->size != q->size)
+            return false;
+
+        if (p->arr == q->arr)
+            return true;
+
+        if (monosHeader(p->arr)->interned && monosHeader(q->arr)->interned)
+            return false;
+
+        for (size_t i = 0; i < p->size; i++) {
+            if (MonoGetExp(&p->arr[i]) != MonoGetExp(&q->arr[i]))
+                return false;
+
+            if (!PolyIsEq(&p->arr[i].p, &q->arr[i].p))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/** Maksymalna liczba sum częściowych w drzewiastym sumowaniu. */
+#define SUM_TREE_DEPTH (sizeof(size_t) * CHAR_BIT)
+
+/**
+ * Stan drzewiastego sumowania wielomianów.
+ * Sumy częściowe łączone są jak cyfry licznika binarnego, więc każdy
+ * składnik bierze udział jedynie w logarytmicznej liczbie scaleń.
+ * */
+typedef struct {
+    Poly sums[SUM_TREE_DEPTH]; ///< sumy częściowe
+    size_t counts[SUM_TREE_DEPTH]; ///< liczby składników sum częściowych
+    size_t size; ///< liczba sum częściowych
+} SumTree;
+
+/**
+ * Dodanie składnika do drzewiastego sumowania.
+ * Wartość przyjmowana jest na własność.
+ * @param[in,out] tree : stan sumowania
+ * @param[in] p : składnik
+ * */
+static void sumTreePush(SumTree *tree, Poly *p) {
+    tree->sums[tree->size] = *p;
+    tree->counts[tree->size++] = 1;
+
+    while (tree->size >= 2
+           && tree->counts[tree->size - 2] == tree->counts[tree->size - 1]) {
+        --tree->size;
+        tree->sums[tree->size - 1] =
+                PolyAddProperty(&tree->sums[tree->size - 1],
+                                &tree->sums[tree->size]);
+        tree->counts[tree->size - 1] *= 2;
+    }
+}
+
+/**
+ * Zakończenie drzewiastego sumowania.
+ * @param[in,out] tree : stan sumowania
+ * @return suma wszystkich składników
+ * */
+static Poly sumTreeTotal(SumTree *tree) {
+    Poly res = PolyZero();
+
+    while (tree->size > 0)
+        res = PolyAddProperty(&tree->sums[--tree->size], &res);
+
+    return res;
+}
+
+poly_coeff_t PolyEvalPoint(const Poly *p, size_t k, const poly_coeff_t xs[]) {
+    assert(hasProperForm(p));
+
+    if (PolyIsCoeff(p))
+        return p->coeff;
+
+    // Dla zmiennej o wartości 0 pozostaje jedynie jednomian o wykładniku 0.
+    if (k == 0 || xs[0] == 0) {
+        const Mono *last = &p->arr[p->size - 1];
+        if (MonoGetExp(last) != 0)
+            return 0;
+
+        return (k == 0) ? PolyEvalPoint(&last->p, 0, xs)
+                        : PolyEvalPoint(&last->p, k - 1, xs + 1);
+    }
+
+    poly_coeff_t res = 0;
+    for (size_t i = 0; i < p->size; ++i) {
+        poly_exp_t gap = MonoGetExp(&p->arr[i])
+                         - (i + 1 < p->size ? MonoGetExp(&p->arr[i + 1]) : 0);
+        res = coeffAdd(res, PolyEvalPoint(&p->arr[i].p, k - 1, xs + 1));
+        res = coeffMul(res, fastPower(xs[0], gap));
+    }
+
+    return res;
+}
+
+/**
+ * Stan wyliczania wartości wielomianu w jednym punkcie.
+ * */
+typedef struct {
+    poly_coeff_t x; ///< punkt
+    poly_coeff_t gapPower; ///< @f$x@f$ do potęgi ostatniej różnicy wykładników
+    poly_coeff_t power; ///< @f$x@f$ do potęgi bieżącego wykładnika
+    poly_coeff_t constant; ///< suma składników stałych
+    bool overflow; ///< czy przepełniło się działanie na współczynnikach
+    SumTree tree; ///< suma przeskalowanych współczynników niestałych
+} AtPoint;
+
+/**
+ * Wyliczenie wartości wielomianu niestałego w wielu punktach naraz.
+ * Potęgi x wyznaczane są od najmniejszego wykładnika przez mnożenie
+ * przez x podniesione do różnicy kolejnych wykładników, ponownie używane,
+ * dopóki różnica się nie zmienia. Składniki stałe sumowane są na bieżąco,
+ * a przeskalowane współczynniki niestałe scalane w miejscu w drzewiastym
+ * sumowaniu, bez sortowania. Wielomian przeglądany jest raz dla wszystkich
+ * punktów.
+ * @param[in] p : wielomian niestały
+ * @param[in] n : liczba punktów
+ * @param[in,out] points : stany punktów z ustawionymi wartościami x
+ * @param[out] out : tablica @f$n@f$ wyników
+ * */
+static void polyAtPoints(const Poly *p, size_t n, AtPoint points[], Poly out[]) {
+    assert(!PolyIsCoeff(p));
+
+    size_t active = n;
+    for (size_t j = 0; j < n; ++j)
+        points[j] = (AtPoint) {.x = points[j].x, .gapPower = 1, .power = 1,
+                               .constant = 0, .overflow = false,
+                               .tree = {.size = 0}};
+
+    poly_exp_t lastGap = 0;
+    for (size_t i = p->size; i-- > 0 && active > 0;) {
+        poly_exp_t gap = MonoGetExp(&p->arr[i])
+                         - (i + 1 < p->size ? MonoGetExp(&p->arr[i + 1]) : 0);
+        const Poly *coeff = &p->arr[i].p;
+
+        for (size_t j = 0; j < n; ++j) {
+            AtPoint *point = &points[j];
+            if (point->power == 0)
+                continue;
+
+            if (gap != lastGap)
+                point->gapPower = fastPower(point->x, gap);
+
+            point->power = coeffMulTrack(point->power, point->gapPower,
+                                         &point->overflow);
+            if (point->power == 0) {
+                --active;
+                continue;
+            }
+
+            if (PolyIsCoeff(coeff)) {
+                poly_coeff_t term = coeffMulTrack(coeff->coeff, point->power,
+                                                  &point->overflow);
+                point->constant = coeffAddTrack(point->constant, term,
+                                                &point->overflow);
+            }
+            else {
+                Poly scaled = PolyClone(coeff);
+                scaled = multConstProperty(&scaled, point->power);
+                sumTreePush(&point->tree, &scaled);
+            }
+        }
+
+        lastGap = gap;
+    }
+
+    for (size_t j = 0; j < n; ++j) {
+        AtPoint *point = &points[j];
+        coeffCheck(point->overflow);
+
+        Poly res = sumTreeTotal(&point->tree);
+        Poly constant = PolyFromCoeff(point->constant);
+        out[j] = PolyAddProperty(&res, &constant);
+    }
+}
+
+Poly PolyAt(const Poly *p, poly_coeff_t x) {
+    assert(hasProperForm(p));
+
+    if (PolyIsCoeff(p))
+        return PolyClone(p);
+
+    // Dla x = 0 pozostaje jedynie współczynnik jednomianu o wykładniku 0.
+    if (x == 0) {
+        const Mono *last = &p->arr[p->size - 1];
+        return (MonoGetExp(last) == 0) ? PolyClone(&last->p) : PolyZero();
+    }
+
+    AtPoint point = {.x = x};
+    Poly res;
+    polyAtPoints(p, 1, &point, &res);
+    return res;
+}
+
+void PolyAtMany(const Poly *p, size_t n, const poly_coeff_t xs[], Poly out[]) {
+    assert(hasProperForm(p));
+
+    if (PolyIsCoeff(p)) {
+        for (size_t j = 0; j < n; ++j)
+            out[j] = PolyClone(p);
+        return;
+    }
+
+    AtPoint *points = safeCalloc(n, sizeof(AtPoint));
+    for (size_t j = 0; j < n; ++j)
+        points[j].x = xs[j];
+
+    polyAtPoints(p, n, points, out);
+    safeFree((void **) &points);
+}
+
+void PrintPolyLaTeX(const Poly *p, char *label) {
+    printf("[%s]: ", label);
+    printPolyLaTeX(p, 0);
+    printf("\n");
+}
+
+void PrintPolyNormalized(const Poly *p) {
+    printPolyNormalized(p, 0);
+}
+
+Poly PolyCloneMonos(size_t count, const Mono monos[]) {
+    if (monos == NULL || count == 0)
+        return PolyZero();
+
+    return polyAddMonosOptSort(count, monos, true, &monoDeepClone);
+}
+
+Poly PolyOwnMonos(size_t count, Mono *monos) {
+    if (monos == NULL)
+        return PolyZero();
+    if (count == 0) {
+        safeFree((void **) &monos);
+        return PolyZero();
+    }
+
+    MonosHeader *header = safeRealloc(monos, sizeof(MonosHeader)
+                                             + count * sizeof(Mono));
+    memmove(header + 1, header, count * sizeof(Mono));
+
+    return polyAddMonosPropertySort(count, monosHeaderInit(header), true);
+}
+
+// POW module
+
+/** Maksymalna liczba wyrazów rozwinięcia wielomianowego potęgi. */
+#define MULTINOMIAL_MAX_TERMS (1 << 22)
+
+/**
+ * Maksymalny stosunek liczby wyrazów rozwinięcia wielomianowego potęgi do
+ * liczby możliwych kluczy potęgi. Powyżej niego wyrazy rozwinięcia często
+ * się sumują i szybsze jest podnoszenie do kwadratu.
+ * */
+#define MULTINOMIAL_COLLISION_FACTOR 2
+
+/**
+ * Odwrotność liczby nieparzystej modulo @f$2^{64}@f$.
+ * Każdy krok metody Newtona podwaja liczbę poprawnych bitów, a przybliżenie
+ * początkowe @f$a@f$ ma ich co najmniej trzy.
+ * @param[in] a : liczba nieparzysta
+ * @return @f$a^{-1} \bmod 2^{64}@f$
+ * */
+static unsigned long oddInverse(unsigned long a) {
+    unsigned long x = a;
+    for (int i = 0; i < 5; ++i)
+        x *= 2 - a * x;
+
+    return x;
+}
+
+/**
+ * Wyznaczenie wiersza trójkąta Pascala modulo @f$2^{64}@f$.
+ * Dzielenie modulo @f$2^{64}@f$ jest możliwe jedynie przez liczby
+ * nieparzyste, więc potęga dwójki w @f$\binom{m}{k}@f$ liczona jest osobno,
+ * a nieparzyste części liczników i mianowników mnożone są wprost.
+ * @param[in] m : numer wiersza
+ * @return tablica @f$\binom{m}{k} \bmod 2^{64}@f$ dla @f$k = 0, \ldots, m@f$
+ * */
+static unsigned long *binomialRow(poly_exp_t m) {
+    unsigned long *row = safeCalloc((size_t) m + 1, sizeof(unsigned long));
+    unsigned long odd = 1;
+    int twos = 0;
+
+    row[0] = 1;
+    for (poly_exp_t k = 1; k <= m; ++k) {
+        unsigned long num = (unsigned long) (m - k + 1), den = (unsigned long) k;
+        int numTwos = __builtin_ctzl(num), denTwos = __builtin_ctzl(den);
+
+        twos += numTwos - denTwos;
+        odd *= num >> numTwos;
+        odd *= oddInverse(den >> denTwos);
+        row[k] = twos >= 64 ? 0 : odd << twos;
+    }
+
+    return row;
+}
+
+/**
+ * Liczba wyrazów rozwinięcia wielomianowego, czyli
+ * @f$\binom{n + t - 1}{t - 1}@f$, ograniczona z góry.
+ * @param[in] n : wykładnik
+ * @param[in] t : liczba wyrazów podstawy
+ * @param[in] cap : ograniczenie
+ * @return liczba wyrazów, lub liczba większa niż @p cap, gdy ją przekracza
+ * */
+static size_t multinomialCount(poly_exp_t n, size_t t, size_t cap) {
+    uint64_t count = 1;
+    for (size_t i = 1; i < t && count <= cap; ++i)
+        count = count * ((uint64_t) n + i) / i;
+
+    return count;
+}
+
+/**
+ * Stan rozwinięcia wielomianowego potęgi wielomianu spłaszczonego.
+ * */
+typedef struct {
+    const FlatPoly *base; ///< podstawa potęgi
+    unsigned long **rows; ///< wyliczone wiersze trójkąta Pascala
+    FlatTerm *terms; ///< zebrane wyrazy
+    size_t size; ///< liczba zebranych wyrazów
+} Multinomial;
+
+/**
+ * Zebranie wyrazów rozwinięcia
+ * @f$\binom{rest}{k_i, \ldots, k_{t-1}} \prod_{j \geq i} c_j^{k_j}@f$
+ * dla wszystkich rozkładów @f$rest = k_i + \ldots + k_{t-1}@f$.
+ * Współczynnik wielomianowy jest iloczynem współczynników dwumianowych
+ * @f$\binom{rest}{k_i}@f$ kolejnych wyrazów. Gałęzie o zerowym
+ * współczynniku są pomijane, bo zerowe są też wszystkie ich wyrazy.
+ * @param[in,out] mn : stan rozwinięcia
+ * @param[in] term : indeks wyrazu podstawy
+ * @param[in] rest : pozostały wykładnik
+ * @param[in] key : klucz wyznaczony przez wcześniejsze wyrazy
+ * @param[in] coeff : współczynnik wyznaczony przez wcześniejsze wyrazy
+ * */
+static void multinomialCollect(Multinomial *mn, size_t term, poly_exp_t rest,
+                               uint64_t key, poly_coeff_t coeff) {
+    const FlatPoly *base = mn->base;
+
+    if (rest == 0 || term + 1 == base->size) {
+        if (rest > 0) {
+            key += (uint64_t) rest * base->keys[term];
+            coeff = coeffMul(coeff, fastPower(base->coeffs[term], rest));
+        }
+
+        if (coeff != 0)
+            mn->terms[mn->size++] = (FlatTerm) {key, coeff};
+        return;
+    }
+
+    if (mn->rows[rest] == NULL)
+        mn->rows[rest] = binomialRow(rest);
+
+    const unsigned long *row = mn->rows[rest];
+    poly_coeff_t power = 1;
+
+    for (poly_exp_t k = 0; k <= rest && power != 0; ++k) {
+        poly_coeff_t c = coeffMul(coeff, coeffMul((poly_coeff_t) row[k], power));
+        if (c != 0)
+            multinomialCollect(mn, term + 1, rest - k, key, c);
+
+        power = coeffMul(power, base->coeffs[term]);
+        key += base->keys[term];
+    }
+}
+
+/**
+ * Sprawdzenie, czy współczynniki potęgi i wszystkie wartości pośrednie
+ * rozwinięcia wielomianowego na pewno mieszczą się w poly_coeff_t.
+ * Ogranicza je @f$n@f$-ta potęga sumy modułów współczynników podstawy.
+ * @param[in] a : wielomian spłaszczony
+ * @param[in] n : wykładnik
+ * @return czy oszacowanie wyklucza przepełnienie
+ * */
+static bool flatPowerFits(const FlatPoly *a, poly_exp_t n) {
+    unsigned long max, sum, bound = 1;
+    if (!flatAbsBounds(a, &max, &sum))
+        return false;
+
+    if (sum <= 1)
+        return true;
+
+    // Suma jest co najmniej dwa, więc pętla kończy się po 63 obrotach.
+    for (poly_exp_t i = 0; i < n; ++i)
+        if (__builtin_mul_overflow(bound, sum, &bound) || bound > LONG_MAX)
+            return false;
+
+    return true;
+}
+
+/**
+ * Potęgowanie wielomianu spłaszczonego rozwinięciem wielomianowym.
+ * Każdy wyraz potęgi powstaje bezpośrednio z wyrazów podstawy, więc nie
+ * powstają potęgi pośrednie. Metoda Millera, wyznaczająca współczynniki
+ * potęgi rekurencją, wymaga dzielenia przez wykładnik, niewykonalnego
+ * modulo @f$2^{64}@f$, więc nie jest używana.
+ * Podstawa ma co najmniej dwa wyrazy, więc wierszy trójkąta Pascala
+ * jest nie więcej niż wyrazów rozwinięcia.
+ * @param[in] a : wielomian spłaszczony o co najmniej dwóch wyrazach
+ * @param[in] n : wykładnik, dodatni
+ * @param[in] count : liczba wyrazów rozwinięcia
+ * @return potęga spłaszczona
+ * */
+static FlatPoly flatMultinomial(const FlatPoly *a, poly_exp_t n, size_t count) {
+    assert(a->size >= 2 && (size_t) n < count);
+
+    Multinomial mn = {.base = a,
+                      .rows = safeCalloc((size_t) n + 1, sizeof(unsigned long *)),
+                      .terms = safeCalloc(count, sizeof(FlatTerm)),
+                      .size = 0};
+
+    multinomialCollect(&mn, 0, n, 0, 1);
+    FlatPoly res = flatFromTerms(mn.terms, mn.size);
+
+    for (poly_exp_t m = 0; m <= n; ++m)
+        safeFree((void **) &mn.rows[m]);
+    safeFree((void **) &mn.rows);
+    safeFree((void **) &mn.terms);
+
+    return res;
+}
+
+/**
+ * Potęgowanie wielomianu spłaszczonego przez podnoszenie do kwadratu.
+ * Bity wykładnika przeglądane są od najstarszego, więc mnożenia innymi
+ * niż kwadraty mają zawsze podstawę jako czynnik.
+ * @param[in] a : niepusty wielomian spłaszczony
+ * @param[in] n : wykładnik, dodatni
+ * @return potęga spłaszczona
+ * */
+static FlatPoly flatPower(const FlatPoly *a, poly_exp_t n) {
+    int bit = 30 - __builtin_clz((unsigned) n);
+
+    FlatPoly res = {.size = a->size,
+                    .keys = safeCalloc(a->size, sizeof(uint64_t)),
+                    .coeffs = safeCalloc(a->size, sizeof(poly_coeff_t))};
+    memcpy(res.keys, a->keys, a->size * sizeof(uint64_t));
+    memcpy(res.coeffs, a->coeffs, a->size * sizeof(poly_coeff_t));
+
+    for (; bit >= 0 && res.size > 0; --bit) {
+        FlatPoly square = flatSquareDispatch(&res);
+        flatPolyDestroy(&res);
+        res = square;
+
+        if (((n >> bit) & 1) && res.size > 0) {
+            FlatPoly prod = flatMulDispatch(&res, a);
+            flatPolyDestroy(&res);
+            res = prod;
+        }
+    }
+
+    return res;
+}
+
+/**
+ * Sprawdzenie, czy wielomian jest jednomianem, czyli czy każdy jego poziom
+ * składa się z jednego jednomianu.
+ * @param[in] p : wielomian
+ * @return czy wielomian jest jednomianem
+ * */
+static bool polyIsMonomial(const Poly *p) {
+    while (!PolyIsCoeff(p)) {
+        if (p->size != 1)
+            return false;
+
+        p = &p->arr[0].p;
+    }
+
+    return true;
+}
+
+/**
+ * Potęgowanie jednomianu: @f$(c x^e)^n = c^n x^{n e}@f$.
+ * Koszt nie zależy od wykładnika, poza potęgowaniem współczynnika.
+ * Wykładnik @f$n e@f$ spoza zakresu poly_exp_t jest liczony modulo
+ * @f$2^{32}@f$ i zgłaszany jak przepełnienie współczynnika.
+ * @param[in] p : jednomian
+ * @param[in] n : wykładnik, dodatni
+ * @return @f$p^n@f$
+ * */
+static Poly monomialPower(const Poly *p, poly_exp_t n) {
+    if (PolyIsCoeff(p))
+        return PolyFromCoeff(fastPower(p->coeff, n));
+
+    Poly coeff = monomialPower(&p->arr[0].p, n);
+    if (PolyIsZero(&coeff))
+        return coeff;
+
+    poly_exp_t exp;
+    coeffCheck(__builtin_mul_overflow(MonoGetExp(&p->arr[0]), n, &exp));
 
-    safeFree((void **) &p->arr);
+    // Wykładnik 0 przy stałym współczynniku oznacza przekręcenie iloczynu.
+    if (exp == 0 && PolyIsCoeff(&coeff))
+        return coeff;
+
+    Mono *monos = monosAlloc(1);
+    monos[0] = MonoFromPoly(&coeff, exp);
+    return polyFromUniqueMonos(1, monos);
 }
 
-Poly PolyClone(const Poly *p) {
-    if (PolyIsCoeff(p))
-        return PolyFromCoeff(p->coeff);
+/**
+ * Potęgowanie wielomianu niestałego przez podnoszenie do kwadratu
+ * w postaci rekurencyjnej, gdy klucze potęgi nie mieszczą się w 64 bitach.
+ * @param[in] p : wielomian niestały
+ * @param[in] n : wykładnik, dodatni
+ * @return @f$p^n@f$
+ * */
+static Poly polyPowerRecursive(const Poly *p, poly_exp_t n) {
+    int bit = 30 - __builtin_clz((unsigned) n);
+    Poly res = PolyClone(p);
 
-    Poly res = {.size = p->size, .arr = safeCalloc(p->size, sizeof(Mono))};
-    for (size_t i = 0; i < p->size; ++i) {
-        res.arr[i] = MonoClone(&p->arr[i]);
+    for (; bit >= 0; --bit) {
+        Poly square = polySquare(&res);
+        PolyDestroy(&res);
+        res = square;
+
+        if ((n >> bit) & 1) {
+            Poly prod = PolyMul(&res, p);
+            PolyDestroy(&res);
+            res = prod;
+        }
     }
 
     return res;
 }
 
-// Niech p, q będą miały posortowane tablice po współczynnikach malejąco.
-Poly PolyAdd(const Poly *p, const Poly *q) {
-    Poly a = PolyClone(p);
-    Poly b = PolyClone(q);
+Poly PolyPow(const Poly *p, poly_exp_t n) {
+    assert(hasProperForm(p) && n >= 0);
 
-    return PolyAddProperty(&a, &b);
-}
+    if (n == 0)
+        return PolyFromCoeff(1);
+    if (PolyIsCoeff(p))
+        return PolyFromCoeff(fastPower(p->coeff, n));
+    if (n == 1)
+        return PolyClone(p);
+    if (polyIsMonomial(p))
+        return monomialPower(p, n);
+
+    const LevelDegs *levels = polyLevels(p);
+    size_t depth = levels->depth;
+    uint64_t *degs = safeCalloc(depth, sizeof(uint64_t));
+    bool expOverflow = false;
+    for (size_t l = 0; l < depth; ++l) {
+        degs[l] = (uint64_t) levels->degs[l] * (uint64_t) n;
+        expOverflow |= degs[l] > INT_MAX;
+    }
+    coeffCheck(expOverflow);
 
-Poly PolyAddMonos(size_t count, const Mono monos[]) {
-    return polyAddMonosOptSort(count, monos, true, &monoIdentity);
-}
+    // Klucze potęg pośrednich są nie większe niż klucze wyniku.
+    KroneckerLayout layout;
+    bool fits = kroneckerLayoutBuild(depth, degs, &layout);
+    safeFree((void **) &degs);
 
-Poly PolyMul(const Poly *p, const Poly *q) {
-    assert(hasProperForm(p) && hasProperForm(q));
+    Poly res;
+    if (fits) {
+        FlatPoly flat = polyFlatten(p, &layout);
+        uint64_t keys = (uint64_t) n * (flat.keys[0] - flat.keys[flat.size - 1]) + 1;
+        size_t count = multinomialCount(n, flat.size, MULTINOMIAL_MAX_TERMS);
+
+        // Współczynniki dwumianowe liczone są modulo 2^64 bez odnotowywania
+        // przepełnień, więc przy ich wykrywaniu rozwinięcie wymaga
+        // oszacowania wykluczającego przepełnienie.
+        FlatPoly flatRes;
+        if (count <= MULTINOMIAL_MAX_TERMS
+            && count / MULTINOMIAL_COLLISION_FACTOR <= keys
+            && (!overflowCheckEnabled || flatPowerFits(&flat, n)))
+            flatRes = flatMultinomial(&flat, n, count);
+        else
+            flatRes = flatPower(&flat, n);
 
-    if (PolyIsCoeff(p) && PolyIsCoeff(q)) {
-        return mulCoeffPoly(p, q);
-    }
-    else if (PolyIsCoeff(p) && !PolyIsCoeff(q)) {
-        return mulNonCoeffAndCoeffPoly(q, p);
-    }
-    else if (PolyIsCoeff(q) && !PolyIsCoeff(p)) {
-        return mulNonCoeffAndCoeffPoly(p, q);
+        res = polyUnflatten(flatRes.keys, flatRes.coeffs, flatRes.size, 0,
+                            &layout);
+        flatPolyDestroy(&flat);
+        flatPolyDestroy(&flatRes);
     }
     else {
-        return mulTwoNonCoeffPoly(p, q);
+        res = polyPowerRecursive(p, n);
     }
-}
 
-Poly PolyNeg(const Poly *p) {
-    assert(hasProperForm(p));
-    Poly a = PolyClone(p);
-    return PolyNegProperty(&a);
+    kroneckerLayoutDestroy(&layout);
+    return res;
 }
 
-Poly PolyNegProperty(Poly *p) {
-    return multConstProperty(p, -1);
-}
+// COMPOSE module
 
-Poly PolySub(const Poly *p, const Poly *q) {
-    Poly qq = PolyNeg(q);
-    Poly res = PolyAdd(p, &qq);
-    PolyDestroy(&qq);
-    return res;
-}
+/** Początkowa pojemność tablicy potęg podstawianego wielomianu. */
+#define INIT_GAP_POWERS_SIZE 4
 
-Poly PolySubProperty(Poly *p, Poly *q) {
-    Poly neg = PolyNegProperty(q);
-    return PolyAddProperty(p, &neg);
-}
+/** Początkowa liczba kubełków pamięci podręcznej potęg. */
+#define INIT_POWER_CACHE_BUCKETS 64
 
-poly_exp_t PolyDegBy(const Poly *p, size_t varIdx) {
-    assert(hasProperForm(p));
+/**
+ * Zapamiętana potęga wielomianu.
+ * */
+typedef struct PowerCacheEntry {
+    Poly base; ///< potęgowany wielomian
+    poly_exp_t exp; ///< wykładnik
+    Poly power; ///< potęga
+    uint64_t hash; ///< hasz pary (podstawa, wykładnik)
+    size_t bytes; ///< szacowana zajmowana pamięć
+    struct PowerCacheEntry *next; ///< następny wpis w kubełku
+    struct PowerCacheEntry *newer; ///< wpis użyty później
+    struct PowerCacheEntry *older; ///< wpis użyty wcześniej
+} PowerCacheEntry;
 
-    if (PolyIsZero(p))
-        return -1;
+/**
+ * Pamięć podręczna potęg wielomianów, wspólna dla wszystkich podstawień.
+ * Wpisy znajdują się w tablicy haszującej i na liście uporządkowanej od
+ * ostatnio użytego. Gdy szacowana zajmowana pamięć przekracza budżet,
+ * usuwane są najdawniej użyte wpisy.
+ * */
+static struct {
+    pthread_mutex_t lock; ///< blokada pamięci podręcznej
+    PowerCacheEntry **buckets; ///< kubełki
+    size_t capacity; ///< liczba kubełków, potęga dwójki
+    size_t size; ///< liczba wpisów
+    size_t bytes; ///< szacowana pamięć zajmowana przez wpisy
+    size_t budget; ///< budżet pamięci, 0 wyłącza pamięć podręczną
+    PowerCacheEntry *newest; ///< ostatnio użyty wpis
+    PowerCacheEntry *oldest; ///< najdawniej użyty wpis
+} powerCache = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+/**
+ * Szacowana pamięć zajmowana przez wielomian.
+ * Współdzielone tablice liczone są przy każdym wystąpieniu.
+ * @param[in] p : wielomian
+ * @return liczba bajtów
+ * */
+static size_t polyBytes(const Poly *p) {
+    if (PolyIsCoeff(p))
+        return 0;
 
-    poly_exp_t cnt = 0;
-    degBy(p, 0, varIdx, &cnt);
+    size_t bytes = sizeof(MonosHeader) + p->size * sizeof(Mono);
+    for (size_t i = 0; i < p->size; ++i)
+        bytes += polyBytes(&p->arr[i].p);
 
-    return cnt;
+    return bytes;
 }
 
-poly_exp_t PolyDeg(const Poly *p) {
-    assert(hasProperForm(p));
+/**
+ * Kubełek pamięci podręcznej dla danego haszu.
+ * Wymaga blokady pamięci podręcznej.
+ * @param[in] hash : hasz
+ * @return wskaźnik na początek listy kubełka
+ * */
+static PowerCacheEntry **powerCacheBucket(uint64_t hash) {
+    return &powerCache.buckets[hash & (powerCache.capacity - 1)];
+}
 
-    if (PolyIsZero(p))
-        return -1;
+/**
+ * Odłączenie wpisu od listy ostatnich użyć.
+ * Wymaga blokady pamięci podręcznej.
+ * @param[in,out] entry : wpis
+ * */
+static void powerCacheUnlink(PowerCacheEntry *entry) {
+    if (entry->newer != NULL)
+        entry->newer->older = entry->older;
+    else
+        powerCache.newest = entry->older;
 
-    if (PolyIsCoeff(p))
-        return 0;
+    if (entry->older != NULL)
+        entry->older->newer = entry->newer;
+    else
+        powerCache.oldest = entry->newer;
+}
 
-    poly_exp_t cnt = 0;
-    for (size_t i = 0; i < p->size; ++i) {
-        poly_exp_t deg = PolyDeg(&p->arr[i].p) + MonoGetExp(&p->arr[i]);
-        cnt = max(cnt, deg);
+/**
+ * Wstawienie wpisu na początek listy ostatnich użyć.
+ * Wymaga blokady pamięci podręcznej.
+ * @param[in,out] entry : wpis
+ * */
+static void powerCachePushNewest(PowerCacheEntry *entry) {
+    entry->newer = NULL;
+    entry->older = powerCache.newest;
+    if (powerCache.newest != NULL)
+        powerCache.newest->newer = entry;
+    else
+        powerCache.oldest = entry;
+    powerCache.newest = entry;
+}
+
+/**
+ * Usunięcie najdawniej użytych wpisów, aż zajmowana pamięć zmieści się
+ * w budżecie.
+ * Wymaga blokady pamięci podręcznej.
+ * */
+static void powerCacheEvict(void) {
+    while (powerCache.bytes > powerCache.budget) {
+        PowerCacheEntry *entry = powerCache.oldest;
+        PowerCacheEntry **link = powerCacheBucket(entry->hash);
+
+        while (*link != entry)
+            link = &(*link)->next;
+
+        *link = entry->next;
+        powerCacheUnlink(entry);
+        powerCache.size--;
+        powerCache.bytes -= entry->bytes;
+
+        PolyDestroy(&entry->base);
+        PolyDestroy(&entry->power);
+        safeFree((void **) &entry);
     }
 
-    return cnt;
+    if (powerCache.size == 0) {
+        safeFree((void **) &powerCache.buckets);
+        powerCache.capacity = 0;
+    }
 }
 
-bool PolyIsEq(const Poly *p, const Poly *q) {
-    assert(hasProperForm(p) && hasProperForm(q));
+/**
+ * Podwojenie liczby kubełków pamięci podręcznej.
+ * Wymaga blokady pamięci podręcznej.
+ * */
+static void powerCacheGrow(void) {
+    PowerCacheEntry **old = powerCache.buckets;
+    size_t oldCapacity = powerCache.capacity;
+
+    powerCache.capacity = (oldCapacity == 0) ? INIT_POWER_CACHE_BUCKETS
+                                             : 2 * oldCapacity;
+    powerCache.buckets = safeCalloc(powerCache.capacity,
+                                    sizeof(PowerCacheEntry *));
+
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        PowerCacheEntry *entry = old[i];
+        while (entry != NULL) {
+            PowerCacheEntry *next = entry->next;
+            PowerCacheEntry **bucket = powerCacheBucket(entry->hash);
+
+            entry->next = *bucket;
+            *bucket = entry;
+            entry = next;
+        }
+    }
 
-    if (PolyIsCoeff(p) ^ PolyIsCoeff(q))
-        return false;
+    safeFree((void **) &old);
+}
 
-    if (PolyIsCoeff(p) && PolyIsCoeff(q)) {
-        return p->coeff == q->coeff;
+/**
+ * Znalezienie wpisu w pamięci podręcznej.
+ * Wymaga blokady pamięci podręcznej.
+ * @param[in] base : potęgowany wielomian
+ * @param[in] exp : wykładnik
+ * @param[in] hash : hasz pary (podstawa, wykładnik)
+ * @return wpis lub NULL
+ * */
+static PowerCacheEntry *powerCacheFind(const Poly *base, poly_exp_t exp,
+                                       uint64_t hash) {
+    if (powerCache.capacity == 0)
+        return NULL;
+
+    for (PowerCacheEntry *entry = *powerCacheBucket(hash); entry != NULL;
+         entry = entry->next) {
+        if (entry->hash == hash && entry->exp == exp
+            && PolyIsEq(&entry->base, base))
+            return entry;
     }
-    else {
-        if (p->size != q->size)
-            return false;
 
-        for (size_t i = 0; i < p->size; i++) {
-            if (MonoGetExp(&p->arr[i]) != MonoGetExp(&q->arr[i]))
-                return false;
+    return NULL;
+}
 
-            if (!PolyIsEq(&p->arr[i].p, &q->arr[i].p))
-                return false;
-        }
+/**
+ * Potęga wielomianu z użyciem pamięci podręcznej.
+ * Brakująca potęga jest wyliczana bez blokady, a następnie zapamiętywana,
+ * o ile mieści się w budżecie. Przy wykrywaniu przepełnień pamięć podręczna
+ * jest pomijana, bo potęga wzięta z niej nie zgłosiłaby ponownie
+ * przepełnienia, a znacznik przepełnienia jest wspólny dla wszystkich wątków,
+ * więc nie da się go przypisać jednemu potęgowaniu.
+ * @param[in] base : potęgowany wielomian
+ * @param[in] baseHash : hasz wielomianu @p base
+ * @param[in] exp : wykładnik
+ * @return @f$base^{exp}@f$
+ * */
+static Poly powerCacheGet(const Poly *base, uint64_t baseHash, poly_exp_t exp) {
+    if (overflowCheckEnabled)
+        return PolyPow(base, exp);
+
+    uint64_t hash = hashMix(baseHash ^ hashMix((uint64_t) exp));
+
+    pthread_mutex_lock(&powerCache.lock);
+    bool enabled = powerCache.budget > 0;
+    PowerCacheEntry *entry = powerCacheFind(base, exp, hash);
+    if (entry != NULL) {
+        powerCacheUnlink(entry);
+        powerCachePushNewest(entry);
+        Poly power = PolyClone(&entry->power);
+        pthread_mutex_unlock(&powerCache.lock);
+        return power;
+    }
+    pthread_mutex_unlock(&powerCache.lock);
+
+    Poly power = PolyPow(base, exp);
+    if (!enabled)
+        return power;
+
+    size_t bytes = sizeof(PowerCacheEntry) + polyBytes(base)
+                   + polyBytes(&power);
+
+    pthread_mutex_lock(&powerCache.lock);
+    if (bytes <= powerCache.budget && powerCacheFind(base, exp, hash) == NULL) {
+        if (powerCache.size >= powerCache.capacity)
+            powerCacheGrow();
+
+        entry = safeMalloc(sizeof(PowerCacheEntry));
+        entry->base = PolyClone(base);
+        entry->exp = exp;
+        entry->power = PolyClone(&power);
+        entry->hash = hash;
+        entry->bytes = bytes;
+
+        PowerCacheEntry **bucket = powerCacheBucket(hash);
+        entry->next = *bucket;
+        *bucket = entry;
+        powerCachePushNewest(entry);
+        powerCache.size++;
+        powerCache.bytes += bytes;
+
+        powerCacheEvict();
     }
+    pthread_mutex_unlock(&powerCache.lock);
 
-    return true;
+    return power;
 }
 
-Poly PolyAt(const Poly *p, poly_coeff_t x) {
-    assert(hasProperForm(p));
-
-    if (PolyIsCoeff(p))
-        return PolyClone(p);
+void PolySetPowerCacheBudget(size_t bytes) {
+    pthread_mutex_lock(&powerCache.lock);
+    powerCache.budget = bytes;
+    powerCacheEvict();
+    pthread_mutex_unlock(&powerCache.lock);
+}
 
-    Poly res = PolyZero();
-    for (size_t i = 0; i < p->size; ++i) {
-        poly_exp_t exp = MonoGetExp(&p->arr[i]);
-        poly_coeff_t substitution = fastPower(x, exp);
+/**
+ * Potęgi podstawianego wielomianu o wykładnikach równych odstępom między
+ * kolejnymi wykładnikami jednomianów.
+ * */
+typedef struct {
+    const Poly *base; ///< podstawiany wielomian
+    uint64_t baseHash; ///< hasz podstawianego wielomianu
+    bool hasHash; ///< czy hasz został wyliczony
+    poly_exp_t *exps; ///< wyliczone wykładniki
+    Poly *powers; ///< wyliczone potęgi
+    size_t size; ///< liczba wyliczonych potęg
+    size_t capacity; ///< pojemność tablic
+} GapPowers;
 
-        Poly toSubstitute = PolyFromCoeff(substitution);
-        Poly multiplied = PolyMul(&p->arr[i].p, &toSubstitute);
-        Poly temp = PolyAdd(&res, &multiplied);
+/**
+ * Potęga podstawianego wielomianu.
+ * Odstępy między wykładnikami często się powtarzają, więc każda potęga
+ * wyliczana jest tylko raz, a potęgi brane są ze wspólnej pamięci
+ * podręcznej.
+ * @param[in,out] gaps : wyliczone potęgi
+ * @param[in] gap : wykładnik, dodatni
+ * @return potęga należąca do @p gaps
+ * */
+static const Poly *gapPower(GapPowers *gaps, poly_exp_t gap) {
+    if (gap == 1)
+        return gaps->base;
 
-        PolyDestroy(&multiplied);
-        PolyDestroy(&res);
-        res = temp;
+    for (size_t i = 0; i < gaps->size; ++i) {
+        if (gaps->exps[i] == gap)
+            return &gaps->powers[i];
     }
 
-    return res;
-}
+    if (gaps->size == gaps->capacity) {
+        gaps->capacity = gaps->capacity == 0 ? INIT_GAP_POWERS_SIZE
+                                             : 2 * gaps->capacity;
+        gaps->exps = safeRealloc(gaps->exps,
+                                 gaps->capacity * sizeof(poly_exp_t));
+        gaps->powers = safeRealloc(gaps->powers,
+                                   gaps->capacity * sizeof(Poly));
+    }
 
-void PrintPolyLaTeX(const Poly *p, char *label) {
-    printf("[%s]: ", label);
-    printPolyLaTeX(p, 0);
-    printf("\n");
-}
+    if (!gaps->hasHash) {
+        gaps->baseHash = polyHash(gaps->base);
+        gaps->hasHash = true;
+    }
 
-void PrintPolyNormalized(const Poly *p) {
-    printPolyNormalized(p, 0);
+    gaps->exps[gaps->size] = gap;
+    gaps->powers[gaps->size] = powerCacheGet(gaps->base, gaps->baseHash, gap);
+    return &gaps->powers[gaps->size++];
 }
 
-Poly PolyCloneMonos(size_t count, const Mono monos[]) {
-    if (monos == NULL || count == 0)
-        return PolyZero();
+/**
+ * Usunięcie wyliczonych potęg z pamięci.
+ * @param[in,out] gaps : wyliczone potęgi
+ * */
+static void gapPowersDestroy(GapPowers *gaps) {
+    for (size_t i = 0; i < gaps->size; ++i)
+        PolyDestroy(&gaps->powers[i]);
 
-    return polyAddMonosOptSort(count, monos, true, &monoDeepClone);
+    safeFree((void **) &gaps->exps);
+    safeFree((void **) &gaps->powers);
 }
 
-Poly PolyOwnMonos(size_t count, Mono *monos) {
-    if (monos == NULL)
-        return PolyZero();
-    if (count == 0) {
-        safeFree((void **) &monos);
-        return PolyZero();
+static Poly polyCompose(const Poly *base, size_t depth, const Poly *substitutes);
+
+/**
+ * Podstawienie dla kolejnych jednomianów wielomianu schematem Hornera.
+ * Dla jednomianów @f$c_i x^{e_i}@f$ o indeksach z przedziału
+ * @f$[start, end)@f$ wylicza
+ * @f$\sum_i c_i(q_1, \ldots) \cdot q_0^{e_i - e_{end - 1}}@f$.
+ * @param[in] base : wielomian niestały, do którego podstawiamy
+ * @param[in] start : indeks pierwszego jednomianu
+ * @param[in] end : indeks za ostatnim jednomianem
+ * @param[in] nextDepth : liczba wielomianów podstawianych do współczynników
+ * @param[in] substitutes : tablica wielomianów podstawianych do
+ * współczynników
+ * @param[in,out] gaps : potęgi wielomianu @f$q_0@f$
+ * @return wielomian po podstawieniu
+ * */
+static Poly composeHornerRange(const Poly *base, size_t start, size_t end,
+                               size_t nextDepth, const Poly *substitutes,
+                               GapPowers *gaps) {
+    Poly res = polyCompose(&base->arr[start].p, nextDepth, substitutes);
+
+    for (size_t k = start + 1; k < end; k++) {
+        const Poly *power = gapPower(gaps, MonoGetExp(&base->arr[k - 1])
+                                           - MonoGetExp(&base->arr[k]));
+        Poly sub = polyCompose(&base->arr[k].p, nextDepth, substitutes);
+        Poly next = PolyMulAddProperty(&sub, &res, power);
+        PolyDestroy(&res);
+        res = next;
     }
 
-    Poly res = polyAddMonosPropertySort(count, monos, true);
-    safeFree((void **) &monos);
     return res;
 }
 
-// COMPOSE module
-
-/** Maksymalna potęga dwójki dla liczb z zakresów. */
-static const poly_exp_t MAX_POWER_OF_TWO = 30;
+/** Minimalna liczba jednomianów, dla której podstawienie jest równoległe. */
+#define PARALLEL_COMPOSE_MIN_MONOS 16
 
 /**
- * Szukanie największej potęgi dwójki, mniejszej równej niż [a].
- * @param[in] a - oraniczenie na potęgę
- * @return potęga dwójki mniejsza równa [a]
+ * Stan równoległego podstawienia.
+ * Jednomiany dzielone są na kolejne kawałki liczone niezależnie schematem
+ * Hornera, a wyniki kawałków łączone są parami w drzewie.
  * */
-static poly_exp_t lastLeqPowerOfTwo(poly_exp_t a) {
-    for (poly_exp_t k = MAX_POWER_OF_TWO; k > 0; k--) {
-        if ((1 << k) & a)
-            return k;
-    }
+typedef struct {
+    const Poly *base; ///< wielomian, do którego podstawiamy
+    size_t nextDepth; ///< liczba wielomianów podstawianych do współczynników
+    const Poly *substitutes; ///< wielomiany podstawiane do współczynników
+    const Poly *substitute; ///< wielomian podstawiany pod zmienną
+    uint64_t hash; ///< hasz wielomianu podstawianego pod zmienną
+    size_t chunks; ///< liczba kawałków
+    Poly *partial; ///< wyniki kawałków
+    size_t stride; ///< odległość łączonych wyników w bieżącym kroku
+} ParallelCompose;
 
-    return 0;
+/**
+ * Indeks za ostatnim jednomianem kawałka.
+ * @param[in] compose : stan równoległego podstawienia
+ * @param[in] idx : indeks kawałka, co najwyżej liczba kawałków
+ * @return indeks za ostatnim jednomianem kawałka @p idx
+ * */
+static inline size_t composeChunkEnd(const ParallelCompose *compose,
+                                     size_t idx) {
+    return (idx + 1) * compose->base->size / compose->chunks;
 }
 
 /**
- * Wyliczenie potęg wielomianu do potęg dwójki.
- * Obliczenie potęg wielomianu [p] postaci @f$p^(2^i)@f$. dla @f$i<=n@f$.
- * @param[in] p - potęgowany wielomian
- * @param[in] n - maksymalne @f$i@f$
+ * Podstawienie dla jednego kawałka jednomianów.
+ * @param[in,out] arg : stan równoległego podstawienia
+ * @param[in] idx : indeks kawałka
  * */
-static Poly* polyPowersOfTwo(Poly *p, poly_exp_t n) {
-    Poly *powers = safeCalloc(n + 1, sizeof(Poly));
+static void parallelComposeChunk(void *arg, size_t idx) {
+    ParallelCompose *compose = arg;
+    GapPowers gaps = {.base = compose->substitute, .baseHash = compose->hash,
+                      .hasHash = true};
 
-    powers[0] = PolyClone(p);
-
-    for (poly_exp_t i = 1; i <= n; ++i) {
-        powers[i] = PolyMul(&powers[i - 1], &powers[i - 1]);
-    }
+    compose->partial[idx] = composeHornerRange(
+            compose->base, idx * compose->base->size / compose->chunks,
+            composeChunkEnd(compose, idx), compose->nextDepth,
+            compose->substitutes, &gaps);
 
-    return powers;
+    gapPowersDestroy(&gaps);
 }
 
 /**
- * Wyczyszczenie tablicy potęg wielomianu.
- * @param[in] count - liczba potęg
- * @param[in] powers - potęgi
+ * Jeden krok drzewiastego łączenia wyników kawałków.
+ * Wynik grupy kawałków @f$A@f$ przesuwany jest o różnicę najmniejszych
+ * wykładników i dodawany do wyniku następnej grupy @f$B@f$.
+ * @param[in,out] arg : stan równoległego podstawienia
+ * @param[in] idx : indeks pary łączonych grup
  * */
-static void clearPowers(size_t count, Poly *powers) {
-    for (size_t i = 0; i <= count; ++i) {
-        PolyDestroy(&powers[i]);
-    }
+static void parallelComposeReduce(void *arg, size_t idx) {
+    ParallelCompose *compose = arg;
+    size_t i = 2 * idx * compose->stride;
+    size_t j = i + compose->stride;
+
+    if (j >= compose->chunks)
+        return;
 
-    safeFree((void **) &powers);
+    size_t lastJ = (j + compose->stride < compose->chunks)
+                   ? j + compose->stride - 1 : compose->chunks - 1;
+    const Mono *minA = &compose->base->arr[composeChunkEnd(compose, j - 1) - 1];
+    const Mono *minB = &compose->base->arr[composeChunkEnd(compose, lastJ) - 1];
+    poly_exp_t gap = MonoGetExp(minA) - MonoGetExp(minB);
+
+    Poly power = powerCacheGet(compose->substitute, compose->hash, gap);
+    Poly sum = PolyMulAddProperty(&compose->partial[j], &compose->partial[i],
+                                  &power);
+    PolyDestroy(&power);
+    PolyDestroy(&compose->partial[i]);
+    compose->partial[i] = sum;
 }
 
 /**
- * Szybkie potęgowanie wielomianu.
- * Szybkie potęgowanie wielomianu znając tablicę potęg danego wielomianu do
- * potęg dwójki.
- * @param[in] polyBiPowers - tablica z potęgi wielomianu do potęg dwójki
- * @param[in] exponent - potęga, do której podnosimy
- * @param[in] maxPowerOfTwo - maksymalna znana potęga dwójki
- * @return wielomian podsniesiony do potęgi [exponent]
+ * Równoległe podstawienie dla wszystkich jednomianów.
+ * Wyniki kawałków łączone są w ustalonym porządku drzewa, więc wynik nie
+ * zależy od przeplotu wątków.
+ * @param[in] base : wielomian niestały, do którego podstawiamy
+ * @param[in] nextDepth : liczba wielomianów podstawianych do współczynników
+ * @param[in] substitutes : tablica wielomianów podstawianych do
+ * współczynników
+ * @param[in] substitute : wielomian podstawiany pod zmienną
+ * @return suma jak w composeHornerRange() dla wszystkich jednomianów
  * */
-static Poly fastPowerPoly(Poly *polyBiPowers,
-                          poly_coeff_t exponent,
-                          poly_coeff_t maxPowerOfTwo) {
-    Poly result = PolyFromCoeff(1);
-
-    for (poly_coeff_t k = 0; k <= maxPowerOfTwo; ++k) {
-        if (exponent & (1 << k)) {
-            Poly newRes = PolyMul(&result, &polyBiPowers[k]);
-            PolyDestroy(&result);
-            result = newRes;
-        }
+static Poly composeParallel(const Poly *base, size_t nextDepth,
+                            const Poly *substitutes, const Poly *substitute) {
+    ParallelCompose compose = {.base = base, .nextDepth = nextDepth,
+                               .substitutes = substitutes,
+                               .substitute = substitute,
+                               .hash = polyHash(substitute)};
+    compose.chunks = threadPoolThreads() * PARALLEL_TASKS_PER_THREAD;
+    if (compose.chunks > base->size)
+        compose.chunks = base->size;
+    compose.partial = safeCalloc(compose.chunks, sizeof(Poly));
+
+    threadPoolFor(compose.chunks, parallelComposeChunk, &compose);
+
+    for (compose.stride = 1; compose.stride < compose.chunks;
+         compose.stride *= 2) {
+        size_t pairs = (compose.chunks + 2 * compose.stride - 1)
+                       / (2 * compose.stride);
+        threadPoolFor(pairs, parallelComposeReduce, &compose);
     }
 
-    return result;
+    Poly res = compose.partial[0];
+    safeFree((void **) &compose.partial);
+    return res;
 }
 
 /**
@@ -812,6 +3567,13 @@ static Poly fastPowerPoly(Poly *polyBiPowers,
  * Podstawienie kolejnych [depth] wielomianów z tablicy [substitutes] pod kolejne
  * zmienne x_i wielomianu [base]. W przypadku zbyt małej liczby wielomianów
  * w tablicy [substitutes], wstawiane są wielomiany zerowe.
+ * Wynik liczony jest schematem Hornera od najwyższego wykładnika:
+ * @f$(\ldots(c_0 q^{e_0 - e_1} + c_1) q^{e_1 - e_2} + \ldots) q^{e_{n-1}}@f$,
+ * więc liczba mnożeń wielomianów jest bliska liczbie jednomianów. Gdy pula
+ * ma więcej niż jeden wątek, a jednomianów jest dużo, schemat Hornera
+ * liczony jest równolegle dla kawałków jednomianów. Przy podstawieniu zera
+ * pozostaje jedynie jednomian stopnia 0, więc reszta poddrzewa jest
+ * pomijana.
  * @param[in] base : wielomian, do którego podstawiamy
  * @param[in] depth : liczba podstawianych wielomianów
  * @param[in] substitutes : tablica podstawianych wielomianów
@@ -821,37 +3583,258 @@ static Poly polyCompose(const Poly *base, size_t depth, const Poly *substitutes)
     if (PolyIsCoeff(base))
         return PolyClone(base);
 
-    Poly substitute = (depth == 0) ? PolyZero() : substitutes[0];
+    size_t nextDepth = (depth == 0) ? depth : depth - 1;
 
-    Poly res = PolyZero();
+    // Pod zerem znikają wszystkie jednomiany poza jednomianem stopnia 0.
+    if (depth == 0 || PolyIsZero(&substitutes[0])) {
+        const Mono *last = &base->arr[base->size - 1];
+        if (MonoGetExp(last) > 0)
+            return PolyZero();
+
+        return polyCompose(&last->p, nextDepth, substitutes + 1);
+    }
+
+    GapPowers gaps = {.base = &substitutes[0]};
+    Poly res;
+
+    if (threadPoolThreads() > 1 && base->size >= PARALLEL_COMPOSE_MIN_MONOS)
+        res = composeParallel(base, nextDepth, substitutes + 1, substitutes);
+    else
+        res = composeHornerRange(base, 0, base->size, nextDepth,
+                                 substitutes + 1, &gaps);
 
-    poly_exp_t maxPower = 0;
-    for (size_t k = 0; k < base->size; k++) {
-        maxPower = max(base->arr[k].exp, maxPower);
+    poly_exp_t last = MonoGetExp(&base->arr[base->size - 1]);
+    if (last > 0) {
+        Poly shifted = PolyMul(&res, gapPower(&gaps, last));
+        PolyDestroy(&res);
+        res = shifted;
     }
 
-    poly_exp_t maxPowerOfTwo = lastLeqPowerOfTwo(maxPower);
-    Poly *substitutePowers = polyPowersOfTwo(&substitute, maxPowerOfTwo);
+    gapPowersDestroy(&gaps);
+
+    return res;
+}
+
+/**
+ * Wartość wielomianu po podstawieniu stałych.
+ * Kolejne zmienne przyjmują wartości współczynników @p q, a pozostałe
+ * wartość 0. Wynik liczony jest schematem Hornera bez alokacji pamięci.
+ * @param[in] p : wielomian
+ * @param[in] k : liczba podstawianych stałych
+ * @param[in] q : tablica podstawianych wielomianów stałych
+ * @return wartość wielomianu
+ * */
+static poly_coeff_t composeConstants(const Poly *p, size_t k, const Poly q[]) {
+    if (PolyIsCoeff(p))
+        return p->coeff;
 
-    for (size_t k = 0; k < base->size; k++) {
-        Poly xPower = fastPowerPoly(substitutePowers,
-                                    base->arr[k].exp,
-                                    maxPowerOfTwo);
-        Poly sub = polyCompose(&base->arr[k].p,
-                               depth == 0 ? depth : depth - 1,
-                               substitutes + 1);
-        Poly new = PolyMul(&sub, &xPower);
-        PolyDestroy(&xPower);
-        PolyDestroy(&sub);
+    if (k == 0 || q[0].coeff == 0) {
+        const Mono *last = &p->arr[p->size - 1];
+        if (MonoGetExp(last) != 0)
+            return 0;
 
-        res = PolyAddProperty(&res, &new);
+        return (k == 0) ? composeConstants(&last->p, 0, q)
+                        : composeConstants(&last->p, k - 1, q + 1);
     }
 
-    clearPowers(maxPowerOfTwo, substitutePowers);
+    poly_coeff_t res = 0;
+    for (size_t i = 0; i < p->size; ++i) {
+        poly_exp_t gap = MonoGetExp(&p->arr[i])
+                         - (i + 1 < p->size ? MonoGetExp(&p->arr[i + 1]) : 0);
+        res = coeffAdd(res, composeConstants(&p->arr[i].p, k - 1, q + 1));
+        res = coeffMul(res, fastPower(q[0].coeff, gap));
+    }
 
     return res;
 }
 
+/**
+ * Podstawiany jednomian jednej zmiennej @f$c x_{var}^{exp}@f$ lub stała.
+ * */
+typedef struct {
+    size_t var; ///< numer zmiennej
+    poly_exp_t exp; ///< wykładnik, 0 dla stałej
+    poly_coeff_t coeff; ///< współczynnik
+} SubstMonomial;
+
+/**
+ * Rozpoznanie jednomianu jednej zmiennej.
+ * @param[in] q : wielomian
+ * @param[out] mono : rozpoznany jednomian
+ * @return czy @f$q@f$ jest stałą lub jednomianem jednej zmiennej
+ * */
+static bool polyAsMonomial(const Poly *q, SubstMonomial *mono) {
+    mono->var = 0;
+
+    while (!PolyIsCoeff(q)) {
+        if (q->size != 1)
+            return false;
+
+        if (MonoGetExp(&q->arr[0]) > 0) {
+            if (!PolyIsCoeff(&q->arr[0].p))
+                return false;
+
+            mono->exp = MonoGetExp(&q->arr[0]);
+            mono->coeff = q->arr[0].p.coeff;
+            return true;
+        }
+
+        q = &q->arr[0].p;
+        mono->var++;
+    }
+
+    mono->exp = 0;
+    mono->coeff = q->coeff;
+    return true;
+}
+
+/**
+ * Stan podstawienia jednomianów jednej zmiennej.
+ * */
+typedef struct {
+    size_t k; ///< liczba podstawianych jednomianów
+    const SubstMonomial *monos; ///< podstawiane jednomiany
+    KroneckerLayout layout; ///< układ Kroneckera wyniku
+    FlatTerm *terms; ///< zebrane wyrazy
+    size_t size; ///< liczba zebranych wyrazów
+} Rename;
+
+/**
+ * Zebranie wyrazów wielomianu po podstawieniu jednomianów.
+ * Wyraz @f$a x_l^{e}@f$ przechodzi na wyraz
+ * @f$a c_l^{e} x_{var_l}^{e \cdot exp_l}@f$.
+ * @param[in,out] rename : stan podstawienia
+ * @param[in] p : wielomian
+ * @param[in] level : numer zmiennej wielomianu
+ * @param[in] key : klucz wyznaczony przez wyższe poziomy
+ * @param[in] coeff : współczynnik wyznaczony przez wyższe poziomy
+ * */
+static void renameCollect(Rename *rename, const Poly *p, size_t level,
+                          uint64_t key, poly_coeff_t coeff) {
+    if (PolyIsCoeff(p)) {
+        poly_coeff_t c = coeffMul(coeff, p->coeff);
+        if (c != 0)
+            rename->terms[rename->size++] = (FlatTerm) {key, c};
+        return;
+    }
+
+    for (size_t i = 0; i < p->size; ++i) {
+        poly_exp_t e = MonoGetExp(&p->arr[i]);
+        uint64_t newKey = key;
+        poly_coeff_t newCoeff = coeff;
+
+        if (level >= rename->k) {
+            if (e > 0)
+                continue;
+        }
+        else {
+            const SubstMonomial *mono = &rename->monos[level];
+            newCoeff = coeffMul(coeff, fastPower(mono->coeff, e));
+            if (newCoeff == 0)
+                continue;
+            if (mono->exp > 0)
+                newKey += (uint64_t) e * (uint64_t) mono->exp
+                          * rename->layout.strides[mono->var];
+        }
+
+        renameCollect(rename, &p->arr[i].p, level + 1, newKey, newCoeff);
+    }
+}
+
+/**
+ * Podstawienie stałych i jednomianów jednej zmiennej, czyli w szczególności
+ * przemianowanie zmiennych.
+ * Wyrazy wielomianu przechodzą na pojedyncze wyrazy wyniku, więc wynik
+ * składany jest bezpośrednio z posortowanych kluczy Kroneckera bez mnożenia
+ * ani dodawania wielomianów.
+ * @param[in] p : wielomian niestały
+ * @param[in] k : liczba podstawianych jednomianów
+ * @param[in] monos : podstawiane jednomiany
+ * @param[out] res : wielomian po podstawieniu
+ * @return czy klucze wyniku mieszczą się w 64 bitach
+ * */
+static bool composeRename(const Poly *p, size_t k, const SubstMonomial *monos,
+                          Poly *res) {
+    size_t depth = 0;
+    for (size_t l = 0; l < k; ++l)
+        if (monos[l].exp > 0 && monos[l].var + 1 > depth)
+            depth = monos[l].var + 1;
+
+    const LevelDegs *pLevels = polyLevels(p);
+    size_t levels = pLevels->depth;
+    const poly_exp_t *degs = pLevels->degs;
+
+    uint64_t *bounds = safeCalloc(depth, sizeof(uint64_t));
+    bool fits = true;
+    for (size_t l = 0; l < k && l < levels && fits; ++l) {
+        if (monos[l].exp == 0)
+            continue;
+
+        uint64_t deg = (uint64_t) degs[l] * (uint64_t) monos[l].exp;
+        bounds[monos[l].var] += deg;
+        fits = bounds[monos[l].var] <= INT_MAX;
+    }
+
+    Rename rename = {.k = k, .monos = monos,
+                     .layout = {.depth = depth,
+                                .bases = safeCalloc(depth, sizeof(uint64_t)),
+                                .strides = safeCalloc(depth, sizeof(uint64_t))}};
+
+    uint64_t stride = 1;
+    for (size_t l = depth; l > 0 && fits; --l) {
+        rename.layout.bases[l - 1] = bounds[l - 1] + 1;
+        rename.layout.strides[l - 1] = stride;
+
+        fits = stride <= UINT64_MAX / (bounds[l - 1] + 1);
+        if (fits)
+            stride *= bounds[l - 1] + 1;
+    }
+    safeFree((void **) &bounds);
+
+    if (!fits) {
+        kroneckerLayoutDestroy(&rename.layout);
+        return false;
+    }
+
+    rename.terms = safeCalloc(polyTermCount(p), sizeof(FlatTerm));
+    renameCollect(&rename, p, 0, 0, 1);
+    FlatPoly flat = flatFromTerms(rename.terms, rename.size);
+
+    *res = polyUnflatten(flat.keys, flat.coeffs, flat.size, 0, &rename.layout);
+
+    flatPolyDestroy(&flat);
+    safeFree((void **) &rename.terms);
+    kroneckerLayoutDestroy(&rename.layout);
+    return true;
+}
+
 Poly PolyCompose(const Poly *p, size_t k, const Poly q[]) {
-    return polyCompose(p, k, q);
+    if (PolyIsCoeff(p))
+        return PolyClone(p);
+
+    size_t used = polyDepth(p);
+    if (k < used)
+        used = k;
+
+    // Podstawienie samych stałych to wyliczenie wartości.
+    bool constants = true;
+    for (size_t l = 0; l < used && constants; ++l)
+        constants = PolyIsCoeff(&q[l]);
+
+    if (constants)
+        return PolyFromCoeff(composeConstants(p, used, q));
+
+    // Przy podstawieniu stałych i jednomianów jednej zmiennej każdy wyraz
+    // przechodzi na jeden wyraz wyniku.
+    SubstMonomial *monos = safeCalloc(used, sizeof(SubstMonomial));
+    bool monomials = true;
+    for (size_t l = 0; l < used && monomials; ++l)
+        monomials = polyAsMonomial(&q[l], &monos[l]);
+
+    Poly res;
+    if (!monomials || !composeRename(p, used, monos, &res))
+        res = polyCompose(p, k, q);
+
+    safeFree((void **) &monos);
+    return res;
 }
@@ -12,6 +12,7 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /** To jest typ reprezentujący współczynniki. */
 typedef long poly_coeff_t;
@@ -126,6 +127,8 @@ static inline void MonoDestroy(Mono *m) {
 
 /**
  * Robi pełną, głęboką kopię wielomianu.
+ * Przy włączonym współdzieleniu (PolySetSharing()) kopia współdzieli pamięć
+ * z oryginałem i jest wykonywana w czasie stałym.
  * @param[in] p : wielomian
  * @return skopiowany wielomian
  */
@@ -165,6 +168,92 @@ Poly PolyAddMonos(size_t count, const Mono monos[]);
  */
 Poly PolyMul(const Poly *p, const Poly *q);
 
+/**
+ * Podnosi wielomian do potęgi.
+ * Kwadraty wyliczane są osobnym algorytmem, który każdy iloczyn różnych
+ * wyrazów wylicza raz. Potęgi rzadkich podstaw, których wyrazy rzadko się
+ * sumują, wyliczane są rozwinięciem wielomianowym bez potęg pośrednich.
+ * Stopnie potęgi względem każdej zmiennej muszą mieścić się w poly_exp_t.
+ * Przy włączonym wykrywaniu przepełnień (PolySetOverflowCheck()) ich
+ * przekroczenie ustawia flagę przepełnienia, a wynik jest nieokreślony,
+ * z wyjątkiem jednomianów, których wykładniki liczone są modulo @f$2^{32}@f$.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] n : wykładnik @f$n@f$, nieujemny
+ * @return @f$p^n@f$, w szczególności @f$p^0 = 1@f$
+ */
+Poly PolyPow(const Poly *p, poly_exp_t n);
+
+/**
+ * Włącza lub wyłącza współdzielenie pamięci przez kopie wielomianów.
+ * Przy włączonym współdzieleniu PolyClone() jedynie zwiększa licznik odwołań
+ * tablicy jednomianów, a tablica kopiowana jest dopiero wtedy, gdy funkcja
+ * przyjmująca wielomian na własność chce ją zmodyfikować. Kopiowana jest
+ * tylko zmieniana ścieżka wielomianu. Wyłączenie współdzielenia nie
+ * rozdziela wielomianów już współdzielących pamięć.
+ * @param[in] enabled : czy współdzielić pamięć
+ */
+void PolySetSharing(bool enabled);
+
+/**
+ * Włącza lub wyłącza internowanie wielomianów.
+ * Przy włączonym internowaniu każdy wynik operacji jest przechowywany
+ * w pamięci tylko raz: równe podwielomiany współdzielą jedną tablicę
+ * jednomianów, a PolyIsEq() dla dwóch wielomianów internowanych porównuje
+ * jedynie wskaźniki. Internowanie włącza też współdzielenie kopii
+ * (PolySetSharing()).
+ * @param[in] enabled : czy internować wielomiany
+ */
+void PolySetInterning(bool enabled);
+
+/**
+ * Ustawia liczbę wątków używanych przez PolyMul().
+ * Dla jednego wątku mnożenie jest sekwencyjne. Wartość 0 oznacza liczbę
+ * wątków odczytaną ze zmiennej środowiskowej `POLY_THREADS` (domyślnie 1,
+ * także dla wartości niepoprawnej, ujemnej lub większej niż kilkukrotność
+ * liczby procesorów). Większe wartości argumentu są do niej ograniczane.
+ * Wywołanie z wartością 1 zatrzymuje wątki robocze.
+ * @param[in] threads : liczba wątków
+ */
+void PolySetThreads(size_t threads);
+
+/**
+ * Włącza lub wyłącza wykrywanie przepełnień współczynników.
+ * Wyniki operacji nie zależą od ustawienia: współczynniki zawsze liczone
+ * są modulo @f$2^{64}@f$. Przy włączonym wykrywaniu przepełnienie
+ * dowolnego pośredniego działania na współczynnikach ustawia flagę
+ * odczytywaną przez PolyClearOverflow(), więc nieustawiona flaga oznacza,
+ * że wyniki są dokładne. Flaga może zostać ustawiona także wtedy, gdy
+ * przepełni się jedynie wartość pośrednia, a wynik się mieści.
+ * @param[in] enabled : czy wykrywać przepełnienia
+ */
+void PolySetOverflowCheck(bool enabled);
+
+/**
+ * Sprawdza, czy przepełnienia współczynników są wykrywane.
+ * @return czy wykrywanie przepełnień jest włączone
+ */
+bool PolyOverflowCheckEnabled(void);
+
+/**
+ * Zeruje flagę przepełnienia współczynników.
+ * @return czy od poprzedniego wywołania wystąpiło przepełnienie
+ */
+bool PolyClearOverflow(void);
+
+/** Domyślny budżet pamięci podręcznej potęg w kalkulatorze, w bajtach. */
+#define DEFAULT_POWER_CACHE_BUDGET ((size_t) 64 << 20)
+
+/**
+ * Ustawia budżet pamięci podręcznej potęg używanej przez PolyCompose().
+ * Potęgi podstawianych wielomianów zapamiętywane są między wywołaniami
+ * i rozpoznawane po strukturze podstawy, a gdy szacowana zajmowana pamięć
+ * przekracza budżet, usuwane są najdawniej użyte. Wartość 0 wyłącza
+ * pamięć podręczną i zwalnia jej zawartość. Przy włączonym wykrywaniu
+ * przepełnień (PolySetOverflowCheck()) pamięć podręczna nie jest używana.
+ * @param[in] bytes : budżet pamięci w bajtach
+ */
+void PolySetPowerCacheBudget(size_t bytes);
+
 /**
  * Zwraca przeciwny wielomian.
  * @param[in] p : wielomian @f$p@f$
@@ -185,7 +274,8 @@ Poly PolySub(const Poly *p, const Poly *q);
  * tożsamościowo równego zeru). Zmienne indeksowane są od 0.
  * Zmienna o indeksie 0 oznacza zmienną główną tego wielomianu.
  * Większe indeksy oznaczają zmienne wielomianów znajdujących się
- * we współczynnikach.
+ * we współczynnikach. Stopnie po wszystkich zmiennych wyznaczane są przy
+ * pierwszym wywołaniu i zapamiętywane do czasu modyfikacji wielomianu.
  * @param[in] p : wielomian
  * @param[in] varIdx : indeks zmiennej
  * @return stopień wielomianu @p p z względu na zmienną o indeksie @p varIdx
@@ -194,6 +284,8 @@ poly_exp_t PolyDegBy(const Poly *p, size_t varIdx);
 
 /**
  * Zwraca stopień wielomianu (-1 dla wielomianu tożsamościowo równego zeru).
+ * Stopień zapamiętywany jest przy tworzeniu wielomianu, więc funkcja
+ * działa w czasie stałym.
  * @param[in] p : wielomian
  * @return stopień wielomianu @p p
  */
@@ -207,6 +299,16 @@ poly_exp_t PolyDeg(const Poly *p);
  */
 bool PolyIsEq(const Poly *p, const Poly *q);
 
+/**
+ * Wyznacza 64-bitowy hasz struktury wielomianu.
+ * Równe wielomiany mają równe hasze, więc różne hasze oznaczają różne
+ * wielomiany. Hasz nie zależy od sposobu utworzenia wielomianu ani od
+ * współdzielenia pamięci.
+ * @param[in] p : wielomian @f$p@f$
+ * @return hasz wielomianu @f$p@f$
+ */
+uint64_t PolyHash(const Poly *p);
+
 /**
  * Wylicza wartość wielomianu w punkcie @p x.
  * Wstawia pod pierwszą zmienną wielomianu wartość @p x.
@@ -220,6 +322,28 @@ bool PolyIsEq(const Poly *p, const Poly *q);
  */
 Poly PolyAt(const Poly *p, poly_coeff_t x);
 
+/**
+ * Wylicza wartości wielomianu w wielu punktach.
+ * Działa jak PolyAt() wywołane dla każdego z punktów, ale przegląda
+ * wielomian tylko raz.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] n : liczba punktów
+ * @param[in] xs : punkty @f$x_0, \ldots, x_{n-1}@f$
+ * @param[out] out : tablica @f$n@f$ wyników @f$p(x_j, x_0, x_1, \ldots)@f$
+ */
+void PolyAtMany(const Poly *p, size_t n, const poly_coeff_t xs[], Poly out[]);
+
+/**
+ * Wylicza wartość wielomianu w punkcie, podstawiając wartości pod wszystkie
+ * zmienne. Zmienne @f$x_i@f$ dla @f$i \geq k@f$ przyjmują wartość 0.
+ * Funkcja nie alokuje pamięci.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] k : liczba podanych wartości
+ * @param[in] xs : wartości @f$x_0, \ldots, x_{k-1}@f$
+ * @return @f$p(x_0, \ldots, x_{k-1}, 0, 0, \ldots)@f$
+ */
+poly_coeff_t PolyEvalPoint(const Poly *p, size_t k, const poly_coeff_t xs[]);
+
 /**
  * Wypisuje wielomian na standardowe wyjście.
  * Wypisuje na standardowe wyjście wielomian @f$p@f$ w formacie @f$\LaTeX{}@f$
@@ -246,6 +370,18 @@ void PrintPolyNormalized(const Poly *p);
  * */
 Poly PolyAddProperty(Poly *a, Poly *b);
 
+/**
+ * Dodaje iloczyn dwóch wielomianów do sumy przyjmowanej na własność.
+ * Dla małych czynników jednomiany iloczynu wyliczane są kolejno
+ * i od razu scalane z tablicą jednomianów sumy, bez tworzenia wielomianu
+ * iloczynu. Czynniki mogą być tym samym wielomianem co suma.
+ * @param[in] acc : suma @f$s@f$, na własność
+ * @param[in] a : wielomian @f$a@f$
+ * @param[in] b : wielomian @f$b@f$
+ * @return @f$s + a\cdot b@f$
+ * */
+Poly PolyMulAddProperty(Poly *acc, const Poly *a, const Poly *b);
+
 /**
  * Działanie identyczne jak PolyNeg(), lecz wielomiany
  * przyjmowane są na własność.
@@ -0,0 +1,507 @@
+/** @file
+ * Implementacja kompilatora wielomianów do programów wyliczających ich
+ * wartości.
+ *
+ * Kompilacja przebiega w dwóch przejściach. Pierwsze przejście znajduje
+ * różne węzły drzewa wielomianu, utożsamiając równe podwielomiany przy tej
+ * samej zmiennej, i zlicza ich użycia. Drugie przejście generuje kod
+ * schematu Hornera dla każdego węzła tylko raz, a rejestr z wynikiem węzła
+ * zwalnia po jego ostatnim użyciu. Rejestry zmiennych i potęg zmiennych
+ * nie są zwalniane.
+ *
+ * Interpreter liczy na typie unsigned long, na którym przekręcenie się jest
+ * dobrze zdefiniowane i zgodne z reprezentacją poly_coeff_t. Instrukcje
+ * arytmetyczne wykonywane są operacjami modułu lane_ops na całym bloku,
+ * więc na procesorach z instrukcjami wektorowymi jedna instrukcja procesora
+ * przetwarza kilka punktów.
+ * */
+
+#include <stdint.h>
+#include <string.h>
+#include "poly_program.h"
+#include "lane_ops.h"
+#include "memory.h"
+
+/** Typ, na którym wykonywane są obliczenia modulo @f$2^{64}@f$. */
+typedef unsigned long ucoeff_t;
+
+/** Licznik użyć rejestru, który nigdy nie jest zwalniany. */
+#define PERMANENT_REG SIZE_MAX
+
+/** Początkowy rozmiar tablic kompilatora. */
+#define INIT_COMPILER_SIZE 16
+
+/**
+ * Argument instrukcji: rejestr albo stała.
+ * */
+typedef struct {
+    bool isReg; ///< czy argument jest rejestrem
+    size_t reg; ///< numer rejestru
+    poly_coeff_t imm; ///< stała
+} Operand;
+
+/**
+ * Węzeł programu: podwielomian przy danej zmiennej albo potęga zmiennej.
+ * */
+typedef struct {
+    const Poly *poly; ///< podwielomian lub NULL dla potęgi zmiennej
+    size_t level; ///< numer zmiennej
+    poly_exp_t exp; ///< wykładnik potęgi zmiennej
+    uint64_t hash; ///< hasz węzła
+    size_t uses; ///< liczba użyć węzła
+    bool emitted; ///< czy kod węzła został wygenerowany
+    Operand value; ///< wynik węzła
+} ProgramNode;
+
+/**
+ * Stan kompilatora.
+ * */
+typedef struct {
+    ProgramInstr *code; ///< wygenerowane instrukcje
+    size_t size; ///< liczba instrukcji
+    size_t capacity; ///< pojemność tablicy instrukcji
+    size_t regs; ///< liczba użytych rejestrów
+    size_t *refs; ///< liczniki pozostałych użyć rejestrów
+    size_t *freeRegs; ///< wolne rejestry
+    size_t freeCount; ///< liczba wolnych rejestrów
+    size_t regCapacity; ///< pojemność tablic rejestrów
+    ProgramNode *nodes; ///< tablica haszująca węzłów z adresowaniem otwartym
+    size_t nodeCount; ///< liczba węzłów
+    size_t nodeCapacity; ///< liczba miejsc w tablicy węzłów, potęga dwójki
+    size_t *vars; ///< rejestry zmiennych lub PERMANENT_REG
+    size_t varCount; ///< długość tablicy rejestrów zmiennych
+} Compiler;
+
+/**
+ * Wymieszanie bitów liczby 64-bitowej (funkcja końcowa SplitMix64).
+ * @param[in] x : liczba
+ * @return wymieszana liczba
+ * */
+static inline uint64_t programHashMix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * Sprawdzenie, czy węzeł tablicy odpowiada szukanemu.
+ * @param[in] node : węzeł tablicy
+ * @param[in] key : szukany węzeł
+ * @return czy węzły są równe
+ * */
+static bool nodeMatches(const ProgramNode *node, const ProgramNode *key) {
+    if (node->hash != key->hash || node->level != key->level)
+        return false;
+
+    if (node->poly == NULL || key->poly == NULL)
+        return node->poly == key->poly && node->exp == key->exp;
+
+    return PolyIsEq(node->poly, key->poly);
+}
+
+/**
+ * Podwojenie tablicy węzłów.
+ * @param[in,out] c : kompilator
+ * */
+static void nodesGrow(Compiler *c) {
+    ProgramNode *old = c->nodes;
+    size_t oldCapacity = c->nodeCapacity;
+
+    c->nodeCapacity = 2 * oldCapacity;
+    c->nodes = safeCalloc(c->nodeCapacity, sizeof(ProgramNode));
+
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        if (old[i].uses == 0)
+            continue;
+
+        size_t pos = old[i].hash & (c->nodeCapacity - 1);
+        while (c->nodes[pos].uses != 0)
+            pos = (pos + 1) & (c->nodeCapacity - 1);
+        c->nodes[pos] = old[i];
+    }
+
+    safeFree((void **) &old);
+}
+
+/**
+ * Znalezienie węzła lub dodanie go z zerową liczbą użyć.
+ * Zwrócony wskaźnik jest ważny do następnego dodania węzła.
+ * @param[in,out] c : kompilator
+ * @param[in] key : szukany węzeł
+ * @param[out] found : czy węzeł już istniał
+ * @return węzeł w tablicy
+ * */
+static ProgramNode *nodeFind(Compiler *c, const ProgramNode *key, bool *found) {
+    if (2 * (c->nodeCount + 1) > c->nodeCapacity)
+        nodesGrow(c);
+
+    size_t pos = key->hash & (c->nodeCapacity - 1);
+    while (c->nodes[pos].uses != 0) {
+        if (nodeMatches(&c->nodes[pos], key)) {
+            *found = true;
+            return &c->nodes[pos];
+        }
+        pos = (pos + 1) & (c->nodeCapacity - 1);
+    }
+
+    *found = false;
+    c->nodes[pos] = *key;
+    c->nodeCount++;
+    return &c->nodes[pos];
+}
+
+/**
+ * Klucz węzła podwielomianu.
+ * @param[in] p : podwielomian niestały
+ * @param[in] level : numer zmiennej podwielomianu
+ * @return klucz węzła
+ * */
+static ProgramNode polyNodeKey(const Poly *p, size_t level) {
+    return (ProgramNode) {.poly = p, .level = level,
+                          .hash = programHashMix(PolyHash(p) + level)};
+}
+
+/**
+ * Dodanie instrukcji do programu.
+ * @param[in,out] c : kompilator
+ * @param[in] instr : instrukcja
+ * */
+static void emit(Compiler *c, ProgramInstr instr) {
+    if (c->size == c->capacity) {
+        c->capacity *= 2;
+        c->code = safeRealloc(c->code, c->capacity * sizeof(ProgramInstr));
+    }
+
+    c->code[c->size++] = instr;
+}
+
+/**
+ * Przydzielenie rejestru o jednym użyciu.
+ * @param[in,out] c : kompilator
+ * @return numer rejestru
+ * */
+static size_t regAlloc(Compiler *c) {
+    size_t reg;
+
+    if (c->freeCount > 0) {
+        reg = c->freeRegs[--c->freeCount];
+    }
+    else {
+        if (c->regs == c->regCapacity) {
+            c->regCapacity *= 2;
+            c->refs = safeRealloc(c->refs, c->regCapacity * sizeof(size_t));
+            c->freeRegs = safeRealloc(c->freeRegs,
+                                      c->regCapacity * sizeof(size_t));
+        }
+        reg = c->regs++;
+    }
+
+    c->refs[reg] = 1;
+    return reg;
+}
+
+/**
+ * Wykorzystanie jednego użycia rejestru.
+ * Rejestr bez pozostałych użyć staje się wolny.
+ * @param[in,out] c : kompilator
+ * @param[in] reg : numer rejestru
+ * */
+static void regRelease(Compiler *c, size_t reg) {
+    if (c->refs[reg] == PERMANENT_REG)
+        return;
+
+    if (--c->refs[reg] == 0)
+        c->freeRegs[c->freeCount++] = reg;
+}
+
+/**
+ * Rejestr z wartością zmiennej.
+ * @param[in,out] c : kompilator
+ * @param[in] level : numer zmiennej
+ * @return numer rejestru
+ * */
+static size_t varReg(Compiler *c, size_t level) {
+    if (level >= c->varCount) {
+        size_t newCount = 2 * (level + 1);
+        c->vars = safeRealloc(c->vars, newCount * sizeof(size_t));
+        for (size_t i = c->varCount; i < newCount; ++i)
+            c->vars[i] = PERMANENT_REG;
+        c->varCount = newCount;
+    }
+
+    if (c->vars[level] == PERMANENT_REG) {
+        size_t reg = regAlloc(c);
+        c->refs[reg] = PERMANENT_REG;
+        emit(c, (ProgramInstr) {.op = PROGRAM_LOAD, .dst = reg, .a = level});
+        c->vars[level] = reg;
+    }
+
+    return c->vars[level];
+}
+
+/**
+ * Rejestr z potęgą zmiennej.
+ * @param[in,out] c : kompilator
+ * @param[in] level : numer zmiennej
+ * @param[in] exp : wykładnik, dodatni
+ * @return numer rejestru
+ * */
+static size_t powerReg(Compiler *c, size_t level, poly_exp_t exp) {
+    if (exp == 1)
+        return varReg(c, level);
+
+    ProgramNode key = {.poly = NULL, .level = level, .exp = exp,
+                       .hash = programHashMix(((uint64_t) exp << 20) ^ level)};
+    bool found;
+    ProgramNode *node = nodeFind(c, &key, &found);
+    if (found)
+        return node->value.reg;
+
+    node->uses = 1;
+    size_t var = varReg(c, level);
+    size_t reg = regAlloc(c);
+    c->refs[reg] = PERMANENT_REG;
+    emit(c, (ProgramInstr) {.op = PROGRAM_POW, .dst = reg, .a = var,
+                            .imm = exp});
+
+    node = nodeFind(c, &key, &found);
+    node->emitted = true;
+    node->value = (Operand) {.isReg = true, .reg = reg};
+    return reg;
+}
+
+/**
+ * Rejestr z wartością argumentu, który można nadpisać.
+ * Przejmuje jedno użycie argumentu.
+ * @param[in,out] c : kompilator
+ * @param[in] operand : argument
+ * @return numer rejestru o jednym użyciu
+ * */
+static size_t ownedReg(Compiler *c, Operand operand) {
+    if (operand.isReg && c->refs[operand.reg] == 1)
+        return operand.reg;
+
+    size_t reg = regAlloc(c);
+    if (operand.isReg) {
+        emit(c, (ProgramInstr) {.op = PROGRAM_COPY, .dst = reg,
+                                .a = operand.reg});
+        regRelease(c, operand.reg);
+    }
+    else {
+        emit(c, (ProgramInstr) {.op = PROGRAM_CONST, .dst = reg,
+                                .imm = operand.imm});
+    }
+
+    return reg;
+}
+
+/**
+ * Pierwsze przejście: zliczenie użyć różnych węzłów.
+ * Do powtórzonego węzła nie trzeba wchodzić.
+ * @param[in,out] c : kompilator
+ * @param[in] p : podwielomian
+ * @param[in] level : numer zmiennej podwielomianu
+ * */
+static void countUses(Compiler *c, const Poly *p, size_t level) {
+    if (PolyIsCoeff(p))
+        return;
+
+    ProgramNode key = polyNodeKey(p, level);
+    bool found;
+    ProgramNode *node = nodeFind(c, &key, &found);
+    node->uses++;
+    if (found)
+        return;
+
+    for (size_t i = 0; i < p->size; ++i)
+        countUses(c, &p->arr[i].p, level + 1);
+}
+
+/**
+ * Drugie przejście: wygenerowanie kodu węzła.
+ * Wartość @f$\sum_i c_i x^{e_i}@f$ liczona jest schematem Hornera od
+ * najwyższego wykładnika. Zwrócony argument ma jedno użycie należące
+ * do wywołującego.
+ * @param[in,out] c : kompilator
+ * @param[in] p : podwielomian
+ * @param[in] level : numer zmiennej podwielomianu
+ * @return wynik węzła
+ * */
+static Operand emitNode(Compiler *c, const Poly *p, size_t level) {
+    if (PolyIsCoeff(p))
+        return (Operand) {.isReg = false, .imm = p->coeff};
+
+    ProgramNode key = polyNodeKey(p, level);
+    bool found;
+    ProgramNode *node = nodeFind(c, &key, &found);
+    assert(found);
+    if (node->emitted)
+        return node->value;
+
+    size_t uses = node->uses;
+    Operand acc = emitNode(c, &p->arr[0].p, level + 1);
+
+    for (size_t i = 1; i < p->size; ++i) {
+        size_t pw = powerReg(c, level, MonoGetExp(&p->arr[i - 1])
+                                       - MonoGetExp(&p->arr[i]));
+        size_t reg = ownedReg(c, acc);
+        Operand child = emitNode(c, &p->arr[i].p, level + 1);
+
+        if (child.isReg) {
+            emit(c, (ProgramInstr) {.op = PROGRAM_MUL_ADD, .dst = reg,
+                                    .a = reg, .b = pw, .c = child.reg});
+            regRelease(c, child.reg);
+        }
+        else {
+            emit(c, (ProgramInstr) {.op = PROGRAM_MUL_ADD_CONST, .dst = reg,
+                                    .a = reg, .b = pw, .imm = child.imm});
+        }
+
+        acc = (Operand) {.isReg = true, .reg = reg};
+    }
+
+    poly_exp_t last = MonoGetExp(&p->arr[p->size - 1]);
+    if (last > 0) {
+        size_t pw = powerReg(c, level, last);
+        size_t reg = ownedReg(c, acc);
+        emit(c, (ProgramInstr) {.op = PROGRAM_MUL, .dst = reg, .a = reg,
+                                .b = pw});
+        acc = (Operand) {.isReg = true, .reg = reg};
+    }
+
+    if (acc.isReg && c->refs[acc.reg] != PERMANENT_REG)
+        c->refs[acc.reg] += uses - 1;
+
+    node = nodeFind(c, &key, &found);
+    node->emitted = true;
+    node->value = acc;
+    return acc;
+}
+
+PolyProgram programCompile(const Poly *p) {
+    Compiler c = {.capacity = INIT_COMPILER_SIZE,
+                  .regCapacity = INIT_COMPILER_SIZE,
+                  .nodeCapacity = INIT_COMPILER_SIZE};
+    c.code = safeCalloc(c.capacity, sizeof(ProgramInstr));
+    c.refs = safeCalloc(c.regCapacity, sizeof(size_t));
+    c.freeRegs = safeCalloc(c.regCapacity, sizeof(size_t));
+    c.nodes = safeCalloc(c.nodeCapacity, sizeof(ProgramNode));
+
+    countUses(&c, p, 0);
+    size_t result = ownedReg(&c, emitNode(&c, p, 0));
+
+    PolyProgram program = {.code = c.code, .size = c.size, .regs = c.regs,
+                           .result = result};
+
+    safeFree((void **) &c.refs);
+    safeFree((void **) &c.freeRegs);
+    safeFree((void **) &c.nodes);
+    safeFree((void **) &c.vars);
+    return program;
+}
+
+void programDestroy(PolyProgram *program) {
+    safeFree((void **) &program->code);
+}
+
+/**
+ * Potęgowanie modulo @f$2^{64}@f$ wszystkich wartości wektora.
+ * Wykładnik jest wspólny, więc potęgowanie przez podnoszenie do kwadratu
+ * wykonuje te same mnożenia wektorów dla wszystkich wartości.
+ * @param[in] ops : operacje na wektorach
+ * @param[out] dst : wynik
+ * @param[in] a : podstawy
+ * @param[in] n : wykładnik, dodatni
+ * @param[in] lanes : długość wektorów
+ * */
+static void lanesPower(const LaneOps *ops, ucoeff_t *dst, const ucoeff_t *a,
+                       poly_coeff_t n, size_t lanes) {
+    ucoeff_t base[PROGRAM_BLOCK_SIZE];
+    memcpy(base, a, lanes * sizeof(ucoeff_t));
+
+    while (!(n & 1)) {
+        ops->mul(base, base, base, lanes);
+        n >>= 1;
+    }
+
+    memcpy(dst, base, lanes * sizeof(ucoeff_t));
+    while ((n >>= 1) > 0) {
+        ops->mul(base, base, base, lanes);
+        if (n & 1)
+            ops->mul(dst, dst, base, lanes);
+    }
+}
+
+/**
+ * Wykonanie programu dla jednego bloku punktów.
+ * @param[in] program : program
+ * @param[in] ops : operacje na wektorach
+ * @param[in,out] regs : rejestry, po @ref PROGRAM_BLOCK_SIZE wartości każdy
+ * @param[in] k : liczba współrzędnych punktu
+ * @param[in] lanes : liczba punktów bloku
+ * @param[in] points : współrzędne punktów bloku
+ * */
+static void programRunBlock(const PolyProgram *program, const LaneOps *ops,
+                            ucoeff_t *regs,
+                            size_t k, size_t lanes,
+                            const poly_coeff_t points[]) {
+    for (size_t i = 0; i < program->size; ++i) {
+        const ProgramInstr *instr = &program->code[i];
+        ucoeff_t *dst = regs + instr->dst * PROGRAM_BLOCK_SIZE;
+        const ucoeff_t *a = regs + instr->a * PROGRAM_BLOCK_SIZE;
+        const ucoeff_t *b = regs + instr->b * PROGRAM_BLOCK_SIZE;
+        const ucoeff_t *c = regs + instr->c * PROGRAM_BLOCK_SIZE;
+        ucoeff_t imm = (ucoeff_t) instr->imm;
+
+        switch (instr->op) {
+            case PROGRAM_LOAD:
+                for (size_t j = 0; j < lanes; ++j)
+                    dst[j] = (instr->a < k)
+                             ? (ucoeff_t) points[j * k + instr->a] : 0;
+                break;
+            case PROGRAM_CONST:
+                for (size_t j = 0; j < lanes; ++j)
+                    dst[j] = imm;
+                break;
+            case PROGRAM_COPY:
+                for (size_t j = 0; j < lanes; ++j)
+                    dst[j] = a[j];
+                break;
+            case PROGRAM_POW:
+                lanesPower(ops, dst, a, instr->imm, lanes);
+                break;
+            case PROGRAM_MUL:
+                ops->mul(dst, a, b, lanes);
+                break;
+            case PROGRAM_MUL_ADD:
+                ops->mulAdd(dst, a, b, c, lanes);
+                break;
+            case PROGRAM_MUL_ADD_CONST:
+                ops->mulAddConst(dst, a, b, imm, lanes);
+                break;
+        }
+    }
+}
+
+void programEval(const PolyProgram *program, size_t k, size_t n,
+                 const poly_coeff_t points[], poly_coeff_t out[]) {
+    const LaneOps *ops = laneOpsBest();
+    ucoeff_t *regs = safeCalloc(program->regs * PROGRAM_BLOCK_SIZE,
+                                sizeof(ucoeff_t));
+
+    for (size_t start = 0; start < n; start += PROGRAM_BLOCK_SIZE) {
+        size_t lanes = (n - start < PROGRAM_BLOCK_SIZE)
+                       ? n - start : PROGRAM_BLOCK_SIZE;
+
+        programRunBlock(program, ops, regs, k, lanes, points + start * k);
+
+        const ucoeff_t *result = regs + program->result * PROGRAM_BLOCK_SIZE;
+        for (size_t j = 0; j < lanes; ++j)
+            out[start + j] = (poly_coeff_t) result[j];
+    }
+
+    safeFree((void **) &regs);
+}
@@ -0,0 +1,81 @@
+/** @file
+ * Interfejs kompilatora wielomianów do programów wyliczających ich wartości.
+ *
+ * Wielomian kompilowany jest do płaskiego programu operującego na
+ * rejestrach. Program składa się z kroków schematu Hornera, potęg zmiennych
+ * wyliczanych raz na blok punktów oraz wspólnych podwyrażeń wyliczanych
+ * tylko raz. Każdy rejestr przechowuje wartości dla całego bloku punktów,
+ * więc interpreter wykonuje każdą instrukcję w ciasnej pętli po punktach
+ * bloku, a dane programu mieszczą się w pamięci podręcznej.
+ *
+ * Wartość programu w punkcie jest równa wartości PolyEvalPoint().
+ * */
+
+#ifndef POLY_PROGRAM_H
+#define POLY_PROGRAM_H
+
+#include <stddef.h>
+#include "poly.h"
+
+/** Liczba punktów przetwarzanych jednocześnie przez interpreter. */
+#define PROGRAM_BLOCK_SIZE 64
+
+/** Rodzaj instrukcji programu. */
+typedef enum {
+    PROGRAM_LOAD, ///< @f$r_{dst} = x_{a}@f$
+    PROGRAM_CONST, ///< @f$r_{dst} = imm@f$
+    PROGRAM_COPY, ///< @f$r_{dst} = r_{a}@f$
+    PROGRAM_POW, ///< @f$r_{dst} = r_{a}^{imm}@f$
+    PROGRAM_MUL, ///< @f$r_{dst} = r_{a} \cdot r_{b}@f$
+    PROGRAM_MUL_ADD, ///< @f$r_{dst} = r_{a} \cdot r_{b} + r_{c}@f$
+    PROGRAM_MUL_ADD_CONST ///< @f$r_{dst} = r_{a} \cdot r_{b} + imm@f$
+} ProgramOp;
+
+/** Instrukcja programu. */
+typedef struct {
+    ProgramOp op; ///< rodzaj instrukcji
+    size_t dst; ///< rejestr wynikowy
+    size_t a; ///< pierwszy argument: rejestr lub numer zmiennej
+    size_t b; ///< drugi argument
+    size_t c; ///< trzeci argument
+    poly_coeff_t imm; ///< stała lub wykładnik
+} ProgramInstr;
+
+/** Program wyliczający wartość wielomianu. */
+typedef struct {
+    ProgramInstr *code; ///< instrukcje
+    size_t size; ///< liczba instrukcji
+    size_t regs; ///< liczba rejestrów
+    size_t result; ///< rejestr z wynikiem
+} PolyProgram;
+
+/**
+ * Kompilacja wielomianu do programu.
+ * Równe podwielomiany przy tej samej zmiennej wyliczane są raz, a każda
+ * potrzebna potęga zmiennej wyliczana jest raz na blok punktów.
+ * @param[in] p : wielomian
+ * @return program wyliczający wartość wielomianu @f$p@f$
+ * */
+PolyProgram programCompile(const Poly *p);
+
+/**
+ * Usunięcie programu z pamięci.
+ * @param[in,out] program : program
+ * */
+void programDestroy(PolyProgram *program);
+
+/**
+ * Wyliczenie wartości programu w wielu punktach.
+ * Punkt @f$j@f$ zajmuje w tablicy @p points pozycje
+ * @f$[jk, (j + 1)k)@f$. Zmienne o numerach co najmniej @f$k@f$ mają
+ * wartość 0, jak w PolyEvalPoint().
+ * @param[in] program : program
+ * @param[in] k : liczba współrzędnych punktu
+ * @param[in] n : liczba punktów
+ * @param[in] points : współrzędne punktów
+ * @param[out] out : tablica @f$n@f$ wartości
+ * */
+void programEval(const PolyProgram *program, size_t k, size_t n,
+                 const poly_coeff_t points[], poly_coeff_t out[]);
+
+#endif //POLY_PROGRAM_H
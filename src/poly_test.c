@@ -4,6 +4,9 @@
 
 #include "poly.h"
 #include "parser.h"
+#include "dense_mul.h"
+#include "poly_program.h"
+#include "lane_ops.h"
 #include <assert.h>
 #include <limits.h>
 #include <stdbool.h>
@@ -2931,6 +2934,15 @@ static bool TestEq(Poly a, Poly b, bool res) {
   return is_eq;
 }
 
+static bool TestPow(Poly a, poly_exp_t n, Poly res) {
+  Poly b = PolyPow(&a, n);
+  bool is_eq = PolyIsEq(&b, &res);
+  PolyDestroy(&a);
+  PolyDestroy(&b);
+  PolyDestroy(&res);
+  return is_eq;
+}
+
 static bool TestAt(Poly a, poly_coeff_t x, Poly res) {
   Poly b = PolyAt(&a, x);
   bool is_eq = PolyIsEq(&b, &res);
@@ -4015,6 +4027,1170 @@ static bool SimpleComposeTest(void) {
   return ok;
 }
 
+static bool MulCancellationTest(void) {
+  const size_t size = 1000;
+  Mono *m = calloc(size, sizeof (Mono));
+  CHECK_PTR(m);
+  for (size_t i = 0; i < size; ++i)
+    m[i] = M(C(1), (poly_exp_t) i);
+  Poly p = PolyAddMonos(size, m);
+  free(m);
+
+  // (1 + x + ... + x^(n-1)) * (1 - x) = 1 - x^n
+  Poly q = P(C(1), 0, C(-1), 1);
+  bool ok = TestOpPtr(&p, &q, P(C(1), 0, C(-1), (poly_exp_t) size), PolyMul);
+  ok &= TestOpPtr(&q, &p, P(C(1), 0, C(-1), (poly_exp_t) size), PolyMul);
+
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  return ok;
+}
+
+static bool MulMultivariateTest(void) {
+  bool res = true;
+  // (x0 x1 + 1)(x0 x1 - 1) = x0^2 x1^2 - 1
+  res &= TestMul(P(C(1), 0, P(C(1), 1), 1),
+                 P(C(-1), 0, P(C(1), 1), 1),
+                 P(C(-1), 0, P(C(1), 2), 2));
+  // (x1 + x2)(x1 - x2) = x1^2 - x2^2
+  res &= TestMul(P(P(P(C(1), 1), 0, C(1), 1), 0),
+                 P(P(P(C(-1), 1), 0, C(1), 1), 0),
+                 P(P(P(C(-1), 2), 0, C(1), 2), 0));
+  // Wykładniki, dla których klucze iloczynu nie mieszczą się w 64 bitach.
+  const poly_exp_t e = 1 << 29;
+  res &= TestMul(P(C(1), 0, P(P(C(1), e), e), e),
+                 P(C(-1), 0, P(P(C(1), e), e), e),
+                 P(C(-1), 0, P(P(C(1), 2 * e), 2 * e), 2 * e));
+  return res;
+}
+
+static bool DenseMulTest(void) {
+  const size_t len1 = 300, len2 = 77;
+  poly_exp_t *exp_list = calloc(len1 + len2, sizeof (poly_exp_t));
+  poly_coeff_t *coef1 = calloc(len1, sizeof (poly_coeff_t));
+  CHECK_PTR(exp_list);
+  CHECK_PTR(coef1);
+  for (size_t i = 0; i < len1 + len2; ++i)
+    exp_list[i] = (poly_exp_t) i;
+  // Duże współczynniki sprawdzają zgodność przekręcania się z mnożeniem
+  // szkolnym.
+  for (size_t i = 0; i < len1; ++i)
+    coef1[i] = coef_arr1[i] * (1L << 40);
+
+  Poly p = MakePoly(len1, coef1, exp_list);
+  Poly q = MakePoly(len2, coef_arr2, exp_list);
+  poly_coeff_t *expected_coef = MullArray(len1, coef1, len2, coef_arr2);
+  Poly expected = MakePoly(len1 + len2, expected_coef, exp_list);
+
+  bool res = true;
+  const size_t thresholds[] = {2, 3, 7, 64, 1000};
+  for (size_t i = 0; i < sizeof (thresholds) / sizeof (thresholds[0]); ++i) {
+    setKaratsubaThreshold(thresholds[i]);
+    setNttThreshold(thresholds[sizeof (thresholds) / sizeof (thresholds[0]) - 1 - i]);
+    res &= TestOpPtr(&p, &q, PolyClone(&expected), PolyMul);
+    res &= TestOpPtr(&q, &p, PolyClone(&expected), PolyMul);
+  }
+  setKaratsubaThreshold(DEFAULT_KARATSUBA_THRESHOLD);
+  setNttThreshold(DEFAULT_NTT_THRESHOLD);
+
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&expected);
+  free(expected_coef);
+  free(coef1);
+  free(exp_list);
+  return res;
+}
+
+static bool NttExtremeCoeffTest(void) {
+  const size_t len = 200;
+  poly_exp_t *exp_list = calloc(2 * len, sizeof (poly_exp_t));
+  poly_coeff_t *coef = calloc(len, sizeof (poly_coeff_t));
+  CHECK_PTR(exp_list);
+  CHECK_PTR(coef);
+  for (size_t i = 0; i < 2 * len; ++i)
+    exp_list[i] = (poly_exp_t) i;
+  for (size_t i = 0; i < len; ++i)
+    coef[i] = (i % 3 == 0) ? LONG_MIN : (i % 3 == 1) ? LONG_MAX : -1;
+
+  Poly p = MakePoly(len, coef, exp_list);
+  poly_coeff_t *expected_coef = MullArray(len, coef, len, coef);
+  Poly expected = MakePoly(2 * len, expected_coef, exp_list);
+
+  setNttThreshold(1);
+  bool res = TestOpPtr(&p, &p, expected, PolyMul);
+  setNttThreshold(DEFAULT_NTT_THRESHOLD);
+
+  PolyDestroy(&p);
+  free(expected_coef);
+  free(coef);
+  free(exp_list);
+  return res;
+}
+
+static Poly ParallelMulFactor(size_t n, poly_coeff_t seed) {
+  Mono *monos = calloc(n, sizeof (Mono));
+  assert(monos != NULL);
+  for (size_t i = 0; i < n; ++i) {
+    poly_coeff_t c = (poly_coeff_t) i * seed + 1;
+    Poly inner = P(C(c), 0, C(-c * seed), (poly_exp_t) (i % 5 + 1));
+    monos[i] = M(inner, (poly_exp_t) (3 * i + seed % 2));
+  }
+  Poly p = PolyAddMonos(n, monos);
+  free(monos);
+  return p;
+}
+
+static bool ParallelMulTest(void) {
+  Poly p = ParallelMulFactor(400, 7);
+  Poly q = ParallelMulFactor(300, 12);
+  Poly r = P(C(1), 0, C(1), 1);
+
+  Poly expected_pq = PolyMul(&p, &q);
+  Poly expected_pr = PolyMul(&p, &r);
+
+  bool res = true;
+  const size_t threads[] = {2, 3, 8};
+  for (size_t i = 0; i < sizeof (threads) / sizeof (threads[0]); ++i) {
+    PolySetThreads(threads[i]);
+    res &= TestOpPtr(&p, &q, PolyClone(&expected_pq), PolyMul);
+    res &= TestOpPtr(&q, &p, PolyClone(&expected_pq), PolyMul);
+    res &= TestOpPtr(&r, &p, PolyClone(&expected_pr), PolyMul);
+  }
+  PolySetThreads(1);
+
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&r);
+  PolyDestroy(&expected_pq);
+  PolyDestroy(&expected_pr);
+  return res;
+}
+
+static bool AddMonosCompactionTest(void) {
+  bool res = true;
+  // Jednomiany o tych samych wykładnikach, zerowe i znoszące się.
+  res &= TestAddMonos(8, (Mono[]) {M(C(1), 3), M(C(0), 0), M(C(2), 3),
+                                   M(C(-3), 3), M(C(4), 1), M(C(5), 0),
+                                   M(C(-4), 1), M(C(0), 0)},
+                      C(5));
+  res &= TestAddMonos(6, (Mono[]) {M(C(1), 2), M(C(1), 0), M(C(-1), 2),
+                                   M(C(7), 4), M(C(1), 2), M(C(-7), 4)},
+                      P(C(1), 0, C(1), 2));
+  res &= TestAddMonos(3, (Mono[]) {M(C(1), 2), M(C(-1), 2), M(C(0), 0)},
+                      C(0));
+  // Mnożenie przez stałą zerujące część współczynników.
+  res &= TestMul(P(C(1L << 32), 0, C(3), 1, C(1L << 62), 2), C(1L << 32),
+                 P(C(3L << 32), 1));
+  return res;
+}
+
+static bool AddInPlaceTest(void) {
+  bool res = true;
+  // Stała dodawana do ostatniego jednomianu, dopisywana lub go znosząca.
+  res &= TestAdd(P(C(1), 0, C(2), 3), C(4), P(C(5), 0, C(2), 3));
+  res &= TestAdd(C(4), P(C(2), 3), P(C(4), 0, C(2), 3));
+  res &= TestAdd(P(C(-4), 0, C(2), 3), C(4), P(C(2), 3));
+  res &= TestAdd(P(P(C(1), 1), 0, C(2), 3), C(4),
+                 P(P(C(4), 0, C(1), 1), 0, C(2), 3));
+  // Scalanie od końca w tablicy dłuższego składnika.
+  res &= TestAdd(P(C(1), 1, C(1), 3, C(1), 5, C(1), 7), P(C(1), 0, C(-1), 5),
+                 P(C(1), 0, C(1), 1, C(1), 3, C(1), 7));
+  res &= TestAdd(P(C(1), 8), P(C(1), 0, C(1), 2, C(1), 4, C(-1), 8),
+                 P(C(1), 0, C(1), 2, C(1), 4));
+  res &= TestAdd(P(C(1), 0, C(1), 2), P(C(-1), 0, C(-1), 2), C(0));
+
+  Poly acc = PolyZero();
+  for (poly_exp_t i = 0; i < 100; ++i) {
+    Poly term = P(C(i + 1), 99 - i);
+    acc = PolyAddProperty(&acc, &term);
+  }
+  for (poly_exp_t i = 0; i < 100; ++i) {
+    Poly term = P(C(-i - 1), i);
+    acc = PolyAddProperty(&acc, &term);
+  }
+  for (poly_exp_t i = 0; i < 100; ++i) {
+    Poly term = P(C(i + 1), i);
+    acc = PolyAddProperty(&acc, &term);
+  }
+  Poly expected = PolyZero();
+  for (poly_exp_t i = 0; i < 100; ++i) {
+    Poly term = P(C(100 - i), i);
+    expected = PolyAddProperty(&expected, &term);
+  }
+  res &= PolyIsEq(&acc, &expected);
+  PolyDestroy(&acc);
+  PolyDestroy(&expected);
+  return res;
+}
+
+static bool SharingTest(void) {
+  bool res = true;
+  PolySetSharing(true);
+
+  Poly p = P(P(C(1), 0, C(2), 1), 0, C(3), 2, P(C(4), 3), 5);
+  Poly expected = P(P(C(1), 0, C(2), 1), 0, C(3), 2, P(C(4), 3), 5);
+  Poly clone = PolyClone(&p);
+  res &= clone.arr == p.arr;
+
+  // Modyfikacje kopii nie mogą zmienić oryginału.
+  Poly one = C(1);
+  clone = PolyAddProperty(&clone, &one);
+  Poly neg = PolyNeg(&p);
+  Poly sum = PolyAdd(&p, &neg);
+  res &= PolyIsZero(&sum);
+  res &= PolyIsEq(&p, &expected);
+
+  Poly expected_clone = P(P(C(2), 0, C(2), 1), 0, C(3), 2, P(C(4), 3), 5);
+  res &= PolyIsEq(&clone, &expected_clone);
+
+  Poly sq = PolyMul(&p, &clone);
+  PolyDestroy(&clone);
+  Poly copy = PolyClone(&p);
+  PolyDestroy(&p);
+  res &= PolyIsEq(&copy, &expected);
+
+  PolySetSharing(false);
+  Poly deep = PolyClone(&copy);
+  res &= deep.arr != copy.arr;
+  Poly sq2 = PolyMul(&deep, &expected_clone);
+  res &= PolyIsEq(&sq, &sq2);
+
+  PolyDestroy(&copy);
+  PolyDestroy(&deep);
+  PolyDestroy(&neg);
+  PolyDestroy(&sq);
+  PolyDestroy(&sq2);
+  PolyDestroy(&expected);
+  PolyDestroy(&expected_clone);
+  return res;
+}
+
+static bool InterningTest(void) {
+  bool res = true;
+  PolySetInterning(true);
+
+  Poly p = P(P(C(1), 0, C(2), 1), 0, P(C(1), 0, C(2), 1), 3);
+  Poly q = P(P(C(1), 0, C(2), 1), 0, P(C(1), 0, C(2), 1), 3);
+  // Równe wielomiany i równe podwielomiany są jedną tablicą.
+  res &= p.arr == q.arr;
+  res &= p.arr[0].p.arr == p.arr[1].p.arr;
+  res &= PolyIsEq(&p, &q);
+
+  Poly x = P(C(1), 1);
+  Poly r = PolyMul(&p, &x);
+  res &= !PolyIsEq(&p, &r);
+
+  // Modyfikacja jednej kopii nie zmienia pozostałych.
+  Poly one = C(1);
+  q = PolyAddProperty(&q, &one);
+  Poly expected = P(P(C(2), 0, C(2), 1), 0, P(C(1), 0, C(2), 1), 3);
+  res &= PolyIsEq(&q, &expected);
+  res &= q.arr == expected.arr;
+  res &= p.arr != q.arr;
+  Poly sub = PolySub(&q, &p);
+  res &= PolyIsEq(&sub, &one);
+
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&r);
+  PolyDestroy(&x);
+  PolyDestroy(&expected);
+  PolyDestroy(&sub);
+  PolySetInterning(false);
+  return res;
+}
+
+static bool HashTest(void) {
+  bool res = true;
+  Poly p = P(P(C(1), 0, C(2), 1), 0, C(3), 2);
+  Poly q = PolyAdd(&(Poly) {.coeff = 1, .arr = NULL}, &p);
+  Poly one = C(1);
+  Poly r = PolySub(&q, &one);
+
+  res &= PolyHash(&p) == PolyHash(&r);
+  res &= PolyHash(&p) != PolyHash(&q);
+  res &= PolyHash(&one) != PolyHash(&(Poly) {.coeff = 2, .arr = NULL});
+
+  // Ta sama struktura na innych zmiennych daje inny hasz.
+  Poly x0 = P(C(1), 1);
+  Poly x1 = P(P(C(1), 1), 0);
+  res &= PolyHash(&x0) != PolyHash(&x1);
+
+  PolySetInterning(true);
+  Poly interned = P(P(C(1), 0, C(2), 1), 0, C(3), 2);
+  res &= PolyHash(&interned) == PolyHash(&p);
+  PolyDestroy(&interned);
+  PolySetInterning(false);
+
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&r);
+  PolyDestroy(&x0);
+  PolyDestroy(&x1);
+  return res;
+}
+
+static bool AtHornerTest(void) {
+  bool res = true;
+  // Wyrazy stałe i zagnieżdżone, rzadkie wykładniki oraz skracanie się.
+  res &= TestAt(P(P(C(1), 0, C(1), 2), 0, C(5), 1, P(C(-4), 2), 2,
+                  P(C(1), 2, C(3), 5), 7), 2,
+                P(C(11), 0, C(113), 2, C(384), 5));
+  res &= TestAt(P(P(C(1), 1), 0, P(C(-1), 1), 1), 1, C(0));
+  res &= TestAt(P(P(C(1), 1), 0, C(3), 1, P(C(1), 2), 40), 0,
+                P(C(1), 1));
+  res &= TestAt(P(C(7), 1, P(C(1), 1), 3), 0, C(0));
+  // Przekręcenie współczynnika zagnieżdżonego do zera.
+  res &= TestAt(P(C(1), 0, P(C(1L << 62), 1, C(1), 3), 2), 2,
+                P(C(1), 0, C(4), 3));
+
+  const size_t len = 1000;
+  Mono *monos = calloc(len, sizeof (Mono));
+  CHECK_PTR(monos);
+  unsigned long expected = 0;
+  unsigned long power = 1;
+  for (size_t i = 0; i < len; ++i) {
+    monos[i] = M(C((poly_coeff_t) (i % 7) - 3 + (i % 7 >= 3)), (poly_exp_t) i);
+    expected += ((i % 7) - 3 + (i % 7 >= 3)) * power;
+    power *= 3;
+  }
+  res &= TestAt(PolyOwnMonos(len, monos), 3, C((poly_coeff_t) expected));
+
+  // Wiele współczynników niestałych o wspólnych wykładnikach.
+  const size_t nested = 37;
+  monos = calloc(nested, sizeof (Mono));
+  CHECK_PTR(monos);
+  for (size_t i = 0; i < nested; ++i)
+    monos[i] = M(P(C(1), 0, C(1), (poly_exp_t) (i % 5) + 1), (poly_exp_t) i);
+  res &= TestAt(PolyOwnMonos(nested, monos), 1,
+                P(C(37), 0, C(8), 1, C(8), 2, C(7), 3, C(7), 4, C(7), 5));
+  return res;
+}
+
+static bool AtManyTest(void) {
+  bool res = true;
+  Poly p = P(P(C(1), 0, C(2), 3), 0, C(-5), 1, P(C(4), 1, C(1), 2), 3,
+             C(7), 4, P(P(C(1), 1), 2), 70);
+  const poly_coeff_t xs[] = {0, 1, -1, 2, 3, 1L << 40, LONG_MIN, 2, -7};
+  const size_t n = sizeof (xs) / sizeof (xs[0]);
+  Poly out[sizeof (xs) / sizeof (xs[0])];
+
+  PolyAtMany(&p, n, xs, out);
+  for (size_t i = 0; i < n; ++i) {
+    Poly expected = PolyAt(&p, xs[i]);
+    res &= PolyIsEq(&out[i], &expected);
+    PolyDestroy(&expected);
+    PolyDestroy(&out[i]);
+  }
+
+  Poly c = C(5);
+  PolyAtMany(&c, 2, xs, out);
+  res &= PolyIsEq(&out[0], &c) && PolyIsEq(&out[1], &c);
+
+  PolyDestroy(&p);
+  return res;
+}
+
+static bool EvalPointTest(void) {
+  bool res = true;
+  Poly p = P(P(C(1), 0, C(2), 3), 0, C(-5), 1,
+             P(C(4), 1, P(C(1), 2, C(-1), 5), 2), 3, C(7), 4,
+             P(P(C(1), 1), 2), 70);
+  const poly_coeff_t xs[] = {3, -2, 5, 1L << 40};
+  const size_t n = sizeof (xs) / sizeof (xs[0]);
+
+  for (size_t k = 0; k <= n; ++k) {
+    // Wartość referencyjna: kolejne podstawienia PolyAt, a potem zera.
+    Poly q = PolyClone(&p);
+    for (size_t i = 0; i < n + 2; ++i) {
+      Poly next = PolyAt(&q, i < k ? xs[i] : 0);
+      PolyDestroy(&q);
+      q = next;
+    }
+    res &= PolyIsCoeff(&q) && PolyEvalPoint(&p, k, xs) == q.coeff;
+    PolyDestroy(&q);
+  }
+
+  Poly c = C(-9);
+  res &= PolyEvalPoint(&c, 0, NULL) == -9;
+  res &= PolyEvalPoint(&c, 2, xs) == -9;
+  PolyDestroy(&p);
+  return res;
+}
+
+static bool ProgramTest(void) {
+  bool res = true;
+  // Powtarzające się poddrzewa przy tych samych zmiennych.
+  Poly s = P(C(3), 0, P(C(1), 1, C(-2), 4), 2);
+  Poly t = P(PolyClone(&s), 1, C(5), 3);
+  Poly polys[] = {
+    P(PolyClone(&t), 0, PolyClone(&s), 2, PolyClone(&t), 5,
+      PolyClone(&s), 9, P(PolyClone(&t), 1), 40),
+    P(P(C(1), 1, C(-1), 7), 0, C(1L << 62), 1, C(7), 70),
+    P(PolyClone(&s), 3),
+    C(-11),
+    C(0)
+  };
+  const size_t count = sizeof (polys) / sizeof (polys[0]);
+  const size_t n = 2 * PROGRAM_BLOCK_SIZE + 7;
+
+  for (size_t k = 0; k <= 4; ++k) {
+    poly_coeff_t *points = malloc((n * k + 1) * sizeof (poly_coeff_t));
+    poly_coeff_t *out = malloc(n * sizeof (poly_coeff_t));
+    unsigned long seed = 12345 + k;
+    for (size_t i = 0; i < n * k; ++i) {
+      seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+      points[i] = (poly_coeff_t) (seed >> (i % 3 == 0 ? 0 : 58));
+    }
+
+    for (size_t j = 0; j < count; ++j) {
+      PolyProgram program = programCompile(&polys[j]);
+      programEval(&program, k, n, points, out);
+      for (size_t i = 0; i < n; ++i)
+        res &= out[i] == PolyEvalPoint(&polys[j], k, points + i * k);
+      programDestroy(&program);
+    }
+
+    free(points);
+    free(out);
+  }
+
+  for (size_t j = 0; j < count; ++j)
+    PolyDestroy(&polys[j]);
+  PolyDestroy(&s);
+  PolyDestroy(&t);
+  return res;
+}
+
+static bool LaneOpsTest(void) {
+  bool res = true;
+  enum { N = 37 };
+  unsigned long a[N], b[N], c[N], expected[N], dst[N];
+  unsigned long seed = 2021;
+  for (size_t j = 0; j < N; ++j) {
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+    a[j] = seed;
+    b[j] = (j % 4 == 0) ? ~0UL - j : seed >> (j % 64);
+    c[j] = seed ^ (seed << 17);
+  }
+
+  for (LaneIsa isa = LANE_SCALAR; isa < LANE_ISA_COUNT; ++isa) {
+    if (!laneOpsSupported(isa))
+      continue;
+    const LaneOps *ops = laneOpsFor(isa);
+
+    // Każda długość sprawdza też obsługę końcówki wektora.
+    for (size_t n = 0; n <= N; ++n) {
+      for (size_t j = 0; j < n; ++j)
+        expected[j] = a[j] * b[j];
+      ops->mul(dst, a, b, n);
+      res &= memcmp(dst, expected, n * sizeof (unsigned long)) == 0;
+
+      for (size_t j = 0; j < n; ++j)
+        expected[j] = a[j] * b[j] + c[j];
+      ops->mulAdd(dst, a, b, c, n);
+      res &= memcmp(dst, expected, n * sizeof (unsigned long)) == 0;
+
+      for (size_t j = 0; j < n; ++j)
+        expected[j] = a[j] * b[j] + 0x9e3779b97f4a7c15UL;
+      ops->mulAddConst(dst, a, b, 0x9e3779b97f4a7c15UL, n);
+      res &= memcmp(dst, expected, n * sizeof (unsigned long)) == 0;
+
+      // Wynik może nadpisać argument.
+      memcpy(dst, a, n * sizeof (unsigned long));
+      for (size_t j = 0; j < n; ++j)
+        expected[j] = a[j] * a[j];
+      ops->mul(dst, dst, dst, n);
+      res &= memcmp(dst, expected, n * sizeof (unsigned long)) == 0;
+    }
+  }
+
+  res &= laneOpsSupported(LANE_SCALAR);
+  return res;
+}
+
+// Podstawienie liczone wprost: suma iloczynów c_i q^(e_i).
+static Poly ComposeReference(const Poly *p, size_t k, const Poly q[]) {
+  if (PolyIsCoeff(p))
+    return PolyClone(p);
+
+  Poly res = PolyZero();
+  for (size_t i = 0; i < p->size; ++i) {
+    Poly term = ComposeReference(&p->arr[i].p, k == 0 ? 0 : k - 1, q + 1);
+    for (poly_exp_t e = 0; e < p->arr[i].exp; ++e) {
+      Poly next = k == 0 ? PolyZero() : PolyMul(&term, &q[0]);
+      PolyDestroy(&term);
+      term = next;
+    }
+    Poly sum = PolyAdd(&res, &term);
+    PolyDestroy(&res);
+    PolyDestroy(&term);
+    res = sum;
+  }
+  return res;
+}
+
+static bool ComposeHornerTest(void) {
+  bool res = true;
+  Poly p = P(P(C(3), 0, C(-1), 2), 0, C(2), 1, P(C(1), 1), 3, C(-4), 4,
+             P(C(5), 0, P(C(1), 3), 1), 7, C(1), 11, C(6), 12);
+  Poly q[] = {
+    P(C(1), 0, P(C(1), 1), 1, C(-2), 2),
+    P(C(2), 1, C(1), 3),
+    P(C(-1), 0, C(1), 1)
+  };
+  const size_t n = sizeof (q) / sizeof (q[0]);
+
+  for (size_t k = 0; k <= n; ++k) {
+    Poly got = PolyCompose(&p, k, q);
+    Poly expected = ComposeReference(&p, k, q);
+    res &= PolyIsEq(&got, &expected);
+    PolyDestroy(&got);
+    PolyDestroy(&expected);
+  }
+
+  // Wielomian bez jednomianu stopnia 0.
+  Poly r = P(C(1), 2, C(1), 5);
+  Poly got = PolyCompose(&r, 1, q);
+  Poly expected = ComposeReference(&r, 1, q);
+  res &= PolyIsEq(&got, &expected);
+  PolyDestroy(&got);
+  PolyDestroy(&expected);
+
+  PolyDestroy(&r);
+  PolyDestroy(&p);
+  for (size_t i = 0; i < n; ++i)
+    PolyDestroy(&q[i]);
+  return res;
+}
+
+static bool PowerCacheTest(void) {
+  bool res = true;
+  Poly p = P(P(C(1), 0, C(2), 3), 1, C(-1), 4, P(C(1), 1, C(5), 2), 9);
+  Poly q[] = {P(C(1), 0, P(C(1), 1), 2), P(C(-3), 0, C(1), 1)};
+  Poly expected = ComposeReference(&p, 2, q);
+
+  // Duży budżet: drugie podstawienie korzysta z zapamiętanych potęg.
+  // Mały budżet: potęgi są od razu usuwane lub wcale niezapamiętywane.
+  const size_t budgets[] = {(size_t) 1 << 24, 600, 1};
+  for (size_t b = 0; b < sizeof (budgets) / sizeof (budgets[0]); ++b) {
+    PolySetPowerCacheBudget(budgets[b]);
+    for (int round = 0; round < 3; ++round) {
+      Poly got = PolyCompose(&p, 2, q);
+      res &= PolyIsEq(&got, &expected);
+      PolyDestroy(&got);
+    }
+  }
+
+  // Podstawa równa strukturalnie, ale w innej pamięci.
+  PolySetPowerCacheBudget((size_t) 1 << 24);
+  Poly first = PolyCompose(&p, 2, q);
+  Poly r[] = {P(C(1), 0, P(C(1), 1), 2), P(C(-3), 0, C(1), 1)};
+  Poly second = PolyCompose(&p, 2, r);
+  res &= PolyIsEq(&first, &expected) && PolyIsEq(&second, &expected);
+  PolySetPowerCacheBudget(0);
+
+  PolyDestroy(&first);
+  PolyDestroy(&second);
+  PolyDestroy(&expected);
+  PolyDestroy(&p);
+  for (size_t i = 0; i < 2; ++i) {
+    PolyDestroy(&q[i]);
+    PolyDestroy(&r[i]);
+  }
+  return res;
+}
+
+static bool ParallelComposeTest(void) {
+  bool res = true;
+  const size_t size = 50;
+  Mono *m = calloc(size, sizeof (Mono));
+  CHECK_PTR(m);
+  for (size_t i = 0; i < size; ++i) {
+    poly_exp_t e = (poly_exp_t) (i * i % 97);
+    m[i] = M(i % 3 == 0 ? P(C(1), 0, C((poly_coeff_t) i + 1), 1) : C(1 + (long) i), e);
+  }
+  Poly p = PolyAddMonos(size, m);
+  free(m);
+  Poly q[] = {P(C(1), 0, P(C(1), 1), 1), P(C(-1), 0, C(2), 1)};
+  Poly expected = ComposeReference(&p, 2, q);
+
+  PolySetThreads(4);
+  for (size_t k = 0; k <= 2; ++k) {
+    Poly got = PolyCompose(&p, k, q);
+    Poly reference = ComposeReference(&p, k, q);
+    res &= PolyIsEq(&got, &reference);
+    PolyDestroy(&got);
+    PolyDestroy(&reference);
+  }
+
+  PolySetPowerCacheBudget((size_t) 1 << 24);
+  Poly got = PolyCompose(&p, 2, q);
+  res &= PolyIsEq(&got, &expected);
+  PolySetPowerCacheBudget(0);
+  PolySetThreads(1);
+
+  PolyDestroy(&got);
+  PolyDestroy(&expected);
+  PolyDestroy(&p);
+  PolyDestroy(&q[0]);
+  PolyDestroy(&q[1]);
+  return res;
+}
+
+static bool ComposeZeroTest(void) {
+  bool res = true;
+  // Sześć zmiennych, duże wykładniki poza jednomianami stopnia 0.
+  Poly p = C(3);
+  for (int level = 0; level < 6; ++level)
+    p = P(p, 0, P(C(1), 1, C(2), 7), 20 + level, C(-1), 1000000);
+  Poly q[] = {P(C(1), 0, C(1), 1), C(0), P(C(2), 2)};
+
+  Poly got = PolyCompose(&p, 0, q);
+  Poly expected = C(3);
+  res &= PolyIsEq(&got, &expected);
+  PolyDestroy(&got);
+  PolyDestroy(&expected);
+
+  // Zero podstawione pod drugą zmienną.
+  Poly r = P(P(C(5), 0, C(1), 3), 0, P(P(C(1), 1), 0, C(2), 2), 2,
+             P(C(4), 1), 3);
+  for (size_t k = 0; k <= 3; ++k) {
+    got = PolyCompose(&r, k, q);
+    expected = ComposeReference(&r, k, q);
+    res &= PolyIsEq(&got, &expected);
+    PolyDestroy(&got);
+    PolyDestroy(&expected);
+  }
+
+  // Wielomian bez jednomianu stopnia 0 znika.
+  Poly s = P(C(1), 4);
+  got = PolyCompose(&s, 2, q + 1);
+  res &= PolyIsZero(&got);
+  PolyDestroy(&got);
+
+  PolyDestroy(&s);
+  PolyDestroy(&r);
+  PolyDestroy(&p);
+  for (size_t i = 0; i < 3; ++i)
+    PolyDestroy(&q[i]);
+  return res;
+}
+
+// Jednomian c * x_var^exp.
+static Poly VarMonomial(size_t var, poly_coeff_t c, poly_exp_t exp) {
+  Poly res = P(C(c), exp);
+  for (size_t i = 0; i < var; ++i)
+    res = P(res, 0);
+  return res;
+}
+
+static bool ComposeFastPathTest(void) {
+  bool res = true;
+  Poly p = P(P(C(3), 0, P(C(1), 2), 1, C(-1), 4), 0,
+             P(C(2), 1, P(C(7), 0, C(1), 3), 2), 2,
+             P(C(1), 0, C(LONG_MAX), 5), 5);
+  Poly cases[][3] = {
+    // Stałe, w tym przekręcające się i zero.
+    {C(3), C(-2), C(5)},
+    {C(1L << 40), C(0), C(-7)},
+    // Permutacja zmiennych.
+    {VarMonomial(1, 1, 1), VarMonomial(0, 1, 1), VarMonomial(2, 1, 1)},
+    {VarMonomial(2, 1, 1), VarMonomial(0, 1, 1), VarMonomial(1, 1, 1)},
+    // Sklejenie zmiennych i jednomiany ze współczynnikiem i potęgą.
+    {VarMonomial(0, 1, 1), VarMonomial(0, 1, 1), VarMonomial(0, 1, 1)},
+    {VarMonomial(1, -2, 3), VarMonomial(0, 1, 2), C(5)},
+    {VarMonomial(3, 1, 1), C(0), VarMonomial(0, 4, 1)},
+    // Jednomian dwóch zmiennych wymaga pełnego podstawienia.
+    {P(P(C(1), 1), 1), VarMonomial(0, 1, 1), C(2)}
+  };
+  const size_t count = sizeof (cases) / sizeof (cases[0]);
+
+  for (size_t c = 0; c < count; ++c) {
+    for (size_t k = 0; k <= 3; ++k) {
+      Poly got = PolyCompose(&p, k, cases[c]);
+      Poly expected = ComposeReference(&p, k, cases[c]);
+      res &= PolyIsEq(&got, &expected);
+      PolyDestroy(&got);
+      PolyDestroy(&expected);
+    }
+    for (size_t i = 0; i < 3; ++i)
+      PolyDestroy(&cases[c][i]);
+  }
+
+  PolyDestroy(&p);
+  return res;
+}
+
+static bool MulAddTest(void) {
+  bool res = true;
+  Poly polys[] = {
+    C(0),
+    C(-3),
+    P(C(1), 0, C(2), 1),
+    P(C(-1), 1, C(1), 3, C(4), 6),
+    P(P(C(1), 0, C(1), 2), 0, P(C(-1), 1), 2),
+    P(P(C(1), 1), 0, C(5), 1, P(C(2), 0, C(1), 1), 2),
+    P(C(LONG_MAX), 1, C(LONG_MIN), 4)
+  };
+  const size_t n = sizeof (polys) / sizeof (polys[0]);
+
+  for (int sharing = 0; sharing <= 1; ++sharing) {
+    PolySetSharing(sharing);
+    for (size_t i = 0; i < n; ++i)
+      for (size_t j = 0; j < n; ++j)
+        for (size_t k = 0; k < n; ++k) {
+          Poly prod = PolyMul(&polys[j], &polys[k]);
+          Poly expected = PolyAdd(&polys[i], &prod);
+          Poly acc = PolyClone(&polys[i]);
+          Poly got = PolyMulAddProperty(&acc, &polys[j], &polys[k]);
+          res &= PolyIsEq(&got, &expected);
+          PolyDestroy(&got);
+          PolyDestroy(&expected);
+          PolyDestroy(&prod);
+        }
+  }
+  PolySetSharing(false);
+
+  // Suma znosząca iloczyn, a także zapis doganiający odczyt.
+  Poly a = P(C(1), 0, C(1), 1);
+  Poly b = P(C(-1), 0, C(1), 1);
+  Poly acc = P(C(1), 0, C(-1), 2);
+  Poly got = PolyMulAddProperty(&acc, &a, &b);
+  res &= PolyIsZero(&got);
+  PolyDestroy(&got);
+
+  Mono *m = calloc(40, sizeof (Mono));
+  CHECK_PTR(m);
+  for (size_t i = 0; i < 40; ++i)
+    m[i] = M(C(1), (poly_exp_t) (3 * i));
+  Poly big = PolyAddMonos(40, m);
+  free(m);
+  Poly prod = PolyMul(&big, &a);
+  Poly expected = PolyAdd(&prod, &a);
+  acc = PolyClone(&a);
+  got = PolyMulAddProperty(&acc, &a, &big);
+  res &= PolyIsEq(&got, &expected);
+
+  PolyDestroy(&got);
+  PolyDestroy(&expected);
+  PolyDestroy(&prod);
+
+  // Suma będąca jednocześnie czynnikiem.
+  acc = PolyClone(&big);
+  prod = PolyMul(&big, &b);
+  expected = PolyAdd(&big, &prod);
+  got = PolyMulAddProperty(&acc, &acc, &b);
+  res &= PolyIsEq(&got, &expected);
+  PolyDestroy(&got);
+  acc = PolyClone(&b);
+  got = PolyMulAddProperty(&acc, &big, &acc);
+  PolyDestroy(&prod);
+  prod = PolyMul(&big, &b);
+  PolyDestroy(&expected);
+  expected = PolyAdd(&b, &prod);
+  res &= PolyIsEq(&got, &expected);
+
+  PolyDestroy(&got);
+  PolyDestroy(&expected);
+  PolyDestroy(&prod);
+  PolyDestroy(&big);
+  PolyDestroy(&a);
+  PolyDestroy(&b);
+  for (size_t i = 0; i < n; ++i)
+    PolyDestroy(&polys[i]);
+  return res;
+}
+
+static Poly RepeatedMul(const Poly *p, poly_exp_t n) {
+  Poly res = C(1);
+  for (poly_exp_t i = 0; i < n; ++i) {
+    Poly next = PolyMul(&res, p);
+    PolyDestroy(&res);
+    res = next;
+  }
+  return res;
+}
+
+static bool PowTest(void) {
+  bool res = true;
+  const poly_exp_t e = 1 << 20;
+  Poly polys[] = {
+    C(0),
+    C(-3),
+    P(C(1), 0, C(1), 1),
+    P(C(3), 0, C(2), 1),
+    P(C(-1), 1, C(1), 3, C(4), 6),
+    P(P(C(1), 0, C(1), 2), 0, P(C(-1), 1), 2),
+    P(P(P(C(1), 0, C(1), 1), 0, C(1), 1), 0, C(1), 1),
+    P(P(C(1), 1), 0, C(5), 1, P(C(2), 0, C(1), 1), 2),
+    P(C(LONG_MAX), 1, C(LONG_MIN), 4),
+    P(P(C(-3), 2), 1),
+    P(P(C(5), 0), 4),
+    // Klucze potęgi nie mieszczą się w 64 bitach.
+    P(P(P(P(C(1), 0, C(1), e), 0, C(1), e), 0, C(1), e), 0, C(1), e)
+  };
+  const size_t n = sizeof (polys) / sizeof (polys[0]);
+
+  for (size_t i = 0; i < n; ++i)
+    for (poly_exp_t k = 0; k <= 7; ++k) {
+      Poly expected = RepeatedMul(&polys[i], k);
+      Poly got = PolyPow(&polys[i], k);
+      res &= PolyIsEq(&got, &expected);
+      PolyDestroy(&got);
+      PolyDestroy(&expected);
+    }
+
+  // Współczynniki dwumianowe z dużą potęgą dwójki w mianowniku.
+  Poly expected = RepeatedMul(&polys[2], 130);
+  Poly got = PolyPow(&polys[2], 130);
+  res &= PolyIsEq(&got, &expected);
+  PolyDestroy(&got);
+  PolyDestroy(&expected);
+
+  // Jednomiany w bardzo dużych potęgach.
+  res &= TestPow(P(C(1), 1), INT_MAX, P(C(1), INT_MAX));
+  res &= TestPow(P(P(C(-1), 3), 2), (1 << 28) + 1,
+                 P(P(C(-1), 3 * (1 << 28) + 3), (1 << 29) + 2));
+  res &= TestPow(P(P(C(2), 1), 1), 1 << 20, C(0));
+
+  // Gęsta podstawa podnoszona do kwadratu szkolnie, algorytmem Karatsuby
+  // i transformatą.
+  const size_t len = 300;
+  Mono *m = calloc(len, sizeof (Mono));
+  CHECK_PTR(m);
+  for (size_t i = 0; i < len; ++i)
+    m[i] = M(C(coef_arr1[i] * (1L << 40)), (poly_exp_t) i);
+  Poly dense = PolyAddMonos(len, m);
+  free(m);
+
+  const size_t thresholds[] = {2, 7, 64, 1000};
+  for (size_t i = 0; i < sizeof (thresholds) / sizeof (thresholds[0]); ++i) {
+    setKaratsubaThreshold(thresholds[i]);
+    setNttThreshold(thresholds[sizeof (thresholds) / sizeof (thresholds[0]) - 1 - i]);
+    for (poly_exp_t k = 2; k <= 3; ++k) {
+      expected = RepeatedMul(&dense, k);
+      got = PolyPow(&dense, k);
+      res &= PolyIsEq(&got, &expected);
+      PolyDestroy(&got);
+      PolyDestroy(&expected);
+    }
+  }
+  setKaratsubaThreshold(DEFAULT_KARATSUBA_THRESHOLD);
+  setNttThreshold(DEFAULT_NTT_THRESHOLD);
+
+  PolyDestroy(&dense);
+  for (size_t i = 0; i < n; ++i)
+    PolyDestroy(&polys[i]);
+  return res;
+}
+
+static Poly SquareReference(const Poly *p) {
+  // (p + 1)(p - 1) + 1 = p^2, a czynniki są różne
+  Poly one = C(1);
+  Poly plus = PolyAdd(p, &one);
+  Poly minus = PolySub(p, &one);
+  Poly prod = PolyMul(&plus, &minus);
+  Poly res = PolyAdd(&prod, &one);
+  PolyDestroy(&plus);
+  PolyDestroy(&minus);
+  PolyDestroy(&prod);
+  return res;
+}
+
+static bool SquareTest(void) {
+  bool res = true;
+  const poly_exp_t e = 1 << 29;
+  Poly polys[] = {
+    P(C(1), 0, C(1), 1),
+    P(C(-1), 1, C(1), 3, C(4), 6),
+    P(P(C(1), 0, C(1), 2), 0, P(C(-1), 1), 2),
+    P(C(LONG_MAX), 1, C(LONG_MIN), 4),
+    // Klucze kwadratu nie mieszczą się w 64 bitach.
+    P(C(1), 0, P(P(C(1), e), e), e),
+    ParallelMulFactor(400, 7)
+  };
+  const size_t n = sizeof (polys) / sizeof (polys[0]);
+
+  const size_t threads[] = {1, 3, 8};
+  for (size_t t = 0; t < sizeof (threads) / sizeof (threads[0]); ++t) {
+    PolySetThreads(threads[t]);
+    for (size_t i = 0; i < n; ++i) {
+      Poly expected = SquareReference(&polys[i]);
+      Poly copy = PolyCloneMonos(polys[i].size, polys[i].arr);
+      res &= TestOpPtr(&polys[i], &polys[i], PolyClone(&expected), PolyMul);
+      res &= TestOpPtr(&polys[i], &copy, expected, PolyMul);
+      PolyDestroy(&copy);
+    }
+  }
+  PolySetThreads(1);
+
+  for (size_t i = 0; i < n; ++i)
+    PolyDestroy(&polys[i]);
+  return res;
+}
+
+/**
+ * Stopień wielomianu po zmiennej wyznaczony bez zapisanych stopni.
+ * @param p wielomian
+ * @param varIdx indeks zmiennej
+ * @return stopień wielomianu po zmiennej o indeksie @p varIdx
+ */
+static poly_exp_t DegByReference(const Poly *p, size_t varIdx) {
+  if (PolyIsCoeff(p))
+    return PolyIsZero(p) ? -1 : 0;
+
+  poly_exp_t deg = 0;
+  for (size_t i = 0; i < p->size; ++i) {
+    poly_exp_t sub = varIdx == 0 ? MonoGetExp(&p->arr[i])
+                                 : DegByReference(&p->arr[i].p, varIdx - 1);
+    if (sub > deg)
+      deg = sub;
+  }
+  return deg;
+}
+
+/**
+ * Stopień wielomianu wyznaczony bez zapisanych stopni.
+ * @param p wielomian
+ * @return stopień wielomianu
+ */
+static poly_exp_t DegReference(const Poly *p) {
+  if (PolyIsCoeff(p))
+    return PolyIsZero(p) ? -1 : 0;
+
+  poly_exp_t deg = 0;
+  for (size_t i = 0; i < p->size; ++i) {
+    poly_exp_t sub = MonoGetExp(&p->arr[i]) + DegReference(&p->arr[i].p);
+    if (sub > deg)
+      deg = sub;
+  }
+  return deg;
+}
+
+/**
+ * Porównuje stopnie wielomianu ze stopniami wyznaczonymi bez zapisanych
+ * stopni.
+ * @param p wielomian
+ * @return czy stopnie są równe
+ */
+static bool CheckDegs(const Poly *p) {
+  bool res = PolyDeg(p) == DegReference(p);
+  for (size_t varIdx = 0; varIdx < 4; ++varIdx)
+    res &= PolyDegBy(p, varIdx) == DegByReference(p, varIdx);
+  return res;
+}
+
+static bool DegCacheTest(void) {
+  bool res = true;
+
+  for (int sharing = 0; sharing < 2; ++sharing) {
+    PolySetSharing(sharing);
+
+    Poly p = P(P(C(1), 0, C(2), 3), 1, P(C(1), 0, P(C(1), 4), 1), 5);
+    Poly q = P(C(1), 0, C(1), 1);
+    res &= CheckDegs(&p);
+
+    // Modyfikacje w miejscu unieważniają zapisane stopnie.
+    Poly copy = PolyClone(&p);
+    Poly lead = P(P(C(-1), 4), 1);
+    Poly top = P(lead, 5);
+    p = PolyAddProperty(&p, &top);
+    res &= CheckDegs(&p) && PolyDeg(&p) == 5 && PolyDegBy(&p, 2) == 0;
+    res &= CheckDegs(&copy) && PolyDeg(&copy) == 10;
+
+    Poly mul = PolyMul(&p, &q);
+    res &= CheckDegs(&mul);
+    mul = PolyMulAddProperty(&mul, &copy, &q);
+    res &= CheckDegs(&mul) && PolyDeg(&mul) == 11;
+
+    Poly neg = PolyNeg(&copy);
+    mul = PolyAddProperty(&mul, &neg);
+    res &= CheckDegs(&mul);
+
+    Poly pow = PolyPow(&copy, 3);
+    res &= CheckDegs(&pow) && PolyDeg(&pow) == 30;
+
+    Poly c = C(7);
+    pow = PolyAddProperty(&pow, &c);
+    res &= CheckDegs(&pow) && PolyDegBy(&pow, 3) == 0;
+
+    Poly zero = C(0), one = C(1);
+    res &= PolyDeg(&zero) == -1 && PolyDegBy(&zero, 0) == -1;
+    res &= PolyDeg(&one) == 0 && PolyDegBy(&one, 1) == 0;
+
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    PolyDestroy(&copy);
+    PolyDestroy(&mul);
+    PolyDestroy(&pow);
+  }
+  PolySetSharing(false);
+
+  return res;
+}
+
+/**
+ * Sprawdza wynik operacji oraz flagę przepełnienia i zeruje flagę.
+ * Przejmuje wielomiany na własność.
+ * @param res wynik operacji
+ * @param expected oczekiwany wynik
+ * @param overflow czy oczekiwane jest przepełnienie
+ * @return czy wynik i flaga są poprawne
+ */
+static bool TestOverflow(Poly res, Poly expected, bool overflow) {
+  bool ok = PolyIsEq(&res, &expected);
+  ok &= PolyClearOverflow() == overflow;
+  PolyDestroy(&res);
+  PolyDestroy(&expected);
+  return ok;
+}
+
+/**
+ * Mnoży wielomiany z wyłączonym i włączonym wykrywaniem przepełnień.
+ * @param p pierwszy czynnik
+ * @param q drugi czynnik
+ * @param overflow czy oczekiwane jest przepełnienie
+ * @return czy wyniki są równe, a flaga poprawna
+ */
+static bool TestMulOverflow(const Poly *p, const Poly *q, bool overflow) {
+  PolySetOverflowCheck(false);
+  Poly expected = PolyMul(p, q);
+  bool ok = !PolyClearOverflow();
+  PolySetOverflowCheck(true);
+  return ok && TestOverflow(PolyMul(p, q), expected, overflow);
+}
+
+/**
+ * Potęguje wielomian z wyłączonym i włączonym wykrywaniem przepełnień.
+ * @param p podstawa
+ * @param n wykładnik
+ * @param overflow czy oczekiwane jest przepełnienie
+ * @return czy wyniki są równe, a flaga poprawna
+ */
+static bool TestPowOverflow(const Poly *p, poly_exp_t n, bool overflow) {
+  PolySetOverflowCheck(false);
+  Poly expected = PolyPow(p, n);
+  bool ok = !PolyClearOverflow();
+  PolySetOverflowCheck(true);
+  return ok && TestOverflow(PolyPow(p, n), expected, overflow);
+}
+
+static bool OverflowCheckTest(void) {
+  bool res = true;
+  PolySetOverflowCheck(true);
+  res &= PolyOverflowCheckEnabled() && !PolyClearOverflow();
+
+  Poly max = C(LONG_MAX), min = C(LONG_MIN), one = C(1);
+  res &= TestOverflow(PolyAdd(&max, &one), C(LONG_MIN), true);
+  res &= TestOverflow(PolySub(&min, &one), C(LONG_MAX), true);
+  res &= TestOverflow(PolyAdd(&min, &max), C(-1), false);
+  res &= TestOverflow(PolyNeg(&min), C(LONG_MIN), true);
+  res &= TestOverflow(PolyNeg(&max), C(-LONG_MAX), false);
+
+  Poly lin = P(C(LONG_MIN), 0, C(1), 1);
+  res &= TestOverflow(PolyNeg(&lin), P(C(LONG_MIN), 0, C(-1), 1), true);
+  res &= TestOverflow(PolyMul(&lin, &one), PolyClone(&lin), false);
+  PolyDestroy(&lin);
+
+  // Potęgowanie liczb nie podnosi do kwadratu, gdy kwadrat jest zbędny.
+  Poly two = C(2), minusTwo = C(-2), big = C(1L << 40);
+  res &= TestPowOverflow(&minusTwo, 63, false);
+  res &= TestPowOverflow(&two, 63, true);
+  res &= TestPowOverflow(&big, 1, false);
+  res &= TestPowOverflow(&big, 2, true);
+
+  Poly xy1 = P(C(1), 0, P(C(1), 1), 1, C(1), 2);
+  res &= TestPowOverflow(&xy1, 9, false);
+  Poly shifted = P(C(1L << 20), 0, C(1), 1);
+  res &= TestPowOverflow(&shifted, 3, false);
+  res &= TestPowOverflow(&shifted, 4, true);
+  PolyDestroy(&xy1);
+  PolyDestroy(&shifted);
+
+  // Iloczyny gęste, które mogą się przepełnić, liczone są transformatą
+  // odtwarzającą dokładne współczynniki.
+  const size_t len1 = 300, len2 = 77;
+  poly_exp_t *exp_list = calloc(len1, sizeof (poly_exp_t));
+  poly_coeff_t *small = calloc(len1, sizeof (poly_coeff_t));
+  poly_coeff_t *large = calloc(len1, sizeof (poly_coeff_t));
+  poly_coeff_t *alternating = calloc(len1, sizeof (poly_coeff_t));
+  poly_coeff_t *ones = calloc(len2, sizeof (poly_coeff_t));
+  CHECK_PTR(exp_list);
+  CHECK_PTR(small);
+  CHECK_PTR(large);
+  CHECK_PTR(alternating);
+  CHECK_PTR(ones);
+  for (size_t i = 0; i < len1; ++i) {
+    exp_list[i] = (poly_exp_t) i;
+    small[i] = (poly_coeff_t) i % 7 - 3;
+    large[i] = coef_arr1[i] * (1L << 40);
+    alternating[i] = (i % 2 == 0) ? 1L << 56 : -(1L << 56);
+  }
+  for (size_t i = 0; i < len2; ++i)
+    ones[i] = 1;
+  Poly p = MakePoly(len1, small, exp_list);
+  Poly q = MakePoly(len2, small, exp_list);
+  Poly r = MakePoly(len1, large, exp_list);
+  Poly s = MakePoly(len1, alternating, exp_list);
+  Poly t = MakePoly(len2, ones, exp_list);
+  res &= TestMulOverflow(&p, &q, false);
+  res &= TestMulOverflow(&p, &p, false);
+  res &= TestMulOverflow(&r, &q, false);
+  res &= TestMulOverflow(&r, &r, true);
+  // Oszacowanie nie wyklucza przepełnienia, lecz współczynniki się mieszczą.
+  res &= TestMulOverflow(&s, &t, false);
+  res &= TestMulOverflow(&s, &s, true);
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&r);
+  PolyDestroy(&s);
+  PolyDestroy(&t);
+  free(exp_list);
+  free(small);
+  free(large);
+  free(alternating);
+  free(ones);
+
+  // Wykładnik potęgi jednomianu poza zakresem poly_exp_t.
+  Poly x2 = P(C(1), 2);
+  Poly pow = PolyPow(&x2, 1 << 30);
+  res &= PolyClearOverflow();
+  PolyDestroy(&pow);
+  pow = PolyPow(&x2, (1 << 30) - 1);
+  res &= !PolyClearOverflow() && PolyDeg(&pow) == INT_MAX - 1;
+  PolyDestroy(&pow);
+  PolyDestroy(&x2);
+
+  Poly x62 = P(C(1), 62);
+  const poly_coeff_t xs[] = {2, 4};
+  res &= PolyEvalPoint(&x62, 1, xs) == 1L << 62 && !PolyClearOverflow();
+  res &= PolyEvalPoint(&x62, 1, xs + 1) == 0 && PolyClearOverflow();
+  PolyDestroy(&x62);
+
+  // Potęga zapamiętana bez wykrywania przepełnień musi zgłosić je ponownie.
+  Poly square = P(C(1), 2);
+  Poly sub = P(C(1), 0, C(3037000500L), 1);
+  PolySetPowerCacheBudget((size_t) 1 << 24);
+  PolySetOverflowCheck(false);
+  Poly composed = PolyCompose(&square, 1, &sub);
+  PolySetOverflowCheck(true);
+  for (int i = 0; i < 2; ++i)
+    res &= TestOverflow(PolyCompose(&square, 1, &sub),
+                        PolyClone(&composed), true);
+  PolySetPowerCacheBudget(0);
+  PolyDestroy(&composed);
+  PolyDestroy(&square);
+  PolyDestroy(&sub);
+
+  PolySetOverflowCheck(false);
+  res &= !PolyOverflowCheckEnabled();
+  res &= TestOverflow(PolyAdd(&max, &one), C(LONG_MIN), false);
+
+  return res;
+}
+
 /** GRUPY TESTÓW **/
 
 static bool SimpleNegGroup(void) {
@@ -4095,6 +5271,31 @@ static const test_list_t test_list[] = {
   TEST(MemoryFreeTest),
   TEST(MemoryGroup),
   TEST(SimpleComposeTest),
+  TEST(MulCancellationTest),
+  TEST(MulMultivariateTest),
+  TEST(DenseMulTest),
+  TEST(NttExtremeCoeffTest),
+  TEST(ParallelMulTest),
+  TEST(AddMonosCompactionTest),
+  TEST(AddInPlaceTest),
+  TEST(SharingTest),
+  TEST(InterningTest),
+  TEST(HashTest),
+  TEST(AtHornerTest),
+  TEST(AtManyTest),
+  TEST(EvalPointTest),
+  TEST(ProgramTest),
+  TEST(LaneOpsTest),
+  TEST(ComposeHornerTest),
+  TEST(PowerCacheTest),
+  TEST(ParallelComposeTest),
+  TEST(ComposeZeroTest),
+  TEST(ComposeFastPathTest),
+  TEST(MulAddTest),
+  TEST(PowTest),
+  TEST(SquareTest),
+  TEST(DegCacheTest),
+  TEST(OverflowCheckTest),
 };
 
 int main() {
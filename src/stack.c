@@ -18,6 +18,7 @@
 static SElem *createSElem(Poly *p) {
     SElem *sElem = safeMalloc(sizeof(SElem));
     sElem->p = *p;
+    sElem->hasHash = false;
 
     return sElem;
 }
@@ -35,6 +36,21 @@ static void destorySingle(SElem *sElem, bool deep) {
     safeFree((void **) &sElem);
 }
 
+/**
+ * Hasz wielomianu elementu stosu.
+ * Hasz jest wyznaczany tylko przy pierwszym wywołaniu.
+ * @param[in,out] sElem : element stosu
+ * @return hasz wielomianu elementu
+ * */
+static uint64_t sElemHash(SElem *sElem) {
+    if (!sElem->hasHash) {
+        sElem->hash = PolyHash(&sElem->p);
+        sElem->hasHash = true;
+    }
+
+    return sElem->hash;
+}
+
 /**
  * Wypisanie elementu stosu na standardowe wyjście
  * Wypisanie elementu stosu na standardowe wyjście wraz zawartym wielomianem
@@ -118,6 +134,18 @@ Poly secondTopStack(Stack *stack) {
     return stack->head->next->p;
 }
 
+uint64_t topStackHash(Stack *stack) {
+    assert(!isEmptyStack(stack));
+
+    return sElemHash(stack->head);
+}
+
+uint64_t secondTopStackHash(Stack *stack) {
+    assert(sizeStack(stack) >= 2);
+
+    return sElemHash(stack->head->next);
+}
+
 Poly takeStack(Stack *stack) {
     Poly p = topStack(stack);
     popStackDeep(stack, false);
@@ -15,6 +15,8 @@
 typedef struct SElem {
    struct SElem *next; ///< następny element stosu
    Poly p; ///< wielomian w wierzchołku
+   uint64_t hash; ///< hasz wielomianu, ważny gdy hasHash
+   bool hasHash; ///< czy hasz wielomianu został już wyznaczony
 } SElem;
 
 /** To jest struktura stosu */
@@ -87,6 +89,26 @@ Poly topStack(Stack *stack);
  * */
 Poly secondTopStack(Stack *stack);
 
+/**
+ * Hasz wierzchołka.
+ * Hasz wielomianu z wierzchołka stosu wyznaczany przez PolyHash() przy
+ * pierwszym zapytaniu i zapamiętywany w elemencie stosu. W przypadku stosu
+ * pustego program zakończy się fałszywą asercją.
+ * @param[in] stack : rozpatrywany stos
+ * @return hasz wierzchołka rozpatrywanego stosu
+ * */
+uint64_t topStackHash(Stack *stack);
+
+/**
+ * Hasz elementu pod wierzchołkiem.
+ * Działa jak topStackHash() dla wielomianu spod wierzchołka stosu.
+ * W przypadku stosu pustego lub o jednym elemencie program zakończy się
+ * fałszywą asercją.
+ * @param[in] stack : rozpatrywany stos
+ * @return hasz wielomianu spod wierzchołka rozpatrywanego stosu
+ * */
+uint64_t secondTopStackHash(Stack *stack);
+
 /**
  * Zabranie wierzchołka.
  * Zabranie wierzchołka ze stosu t.j. usunięcie do ze stosu
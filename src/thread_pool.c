@@ -0,0 +1,259 @@
+/** @file
+ * Implementacja puli wątków z podkradaniem zadań.
+ * */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "thread_pool.h"
+#include "memory.h"
+
+/** Początkowa pojemność kolejki zadań. */
+#define INIT_DEQUE_SIZE 16
+
+/**
+ * Zadanie puli: jedno wywołanie funkcji z threadPoolFor().
+ * */
+typedef struct {
+    void (*fn)(void *arg, size_t idx); ///< wykonywana funkcja
+    void *arg; ///< argument funkcji
+    size_t idx; ///< indeks wywołania
+    atomic_size_t *remaining; ///< licznik niezakończonych zadań grupy
+} Task;
+
+/**
+ * Kolejka dwustronna zadań jednego wątku.
+ * Zadania znajdują się w buforze cyklicznym na pozycjach
+ * @f$[head, head + size)@f$.
+ * */
+typedef struct {
+    pthread_mutex_t lock; ///< blokada kolejki
+    Task *tasks; ///< bufor cykliczny zadań
+    size_t head; ///< indeks pierwszego zadania
+    size_t size; ///< liczba zadań
+    size_t capacity; ///< pojemność bufora
+} Deque;
+
+/** Stan puli wątków. */
+static struct {
+    size_t threads; ///< łączna liczba wątków
+    pthread_t *workers; ///< wątki robocze, bez wątku głównego
+    size_t started; ///< liczba uruchomionych wątków roboczych
+    Deque *deques; ///< kolejki zadań, kolejka 0 należy do wątku głównego
+    atomic_bool stop; ///< czy wątki robocze mają się zakończyć
+    atomic_size_t pending; ///< liczba zadań w kolejkach
+    pthread_mutex_t idleLock; ///< blokada uśpienia wątków
+    pthread_cond_t idleCond; ///< sygnał pojawienia się zadań
+} pool = {.threads = 1};
+
+/** Indeks kolejki bieżącego wątku. */
+static _Thread_local size_t workerIdx = 0;
+
+/**
+ * Odłożenie zadania na koniec kolejki.
+ * @param[in,out] deque : kolejka
+ * @param[in] task : zadanie
+ * */
+static void dequePushBack(Deque *deque, Task task) {
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->size == deque->capacity) {
+        size_t newCapacity = deque->capacity == 0 ? INIT_DEQUE_SIZE
+                                                  : 2 * deque->capacity;
+        Task *tasks = safeCalloc(newCapacity, sizeof(Task));
+        for (size_t i = 0; i < deque->size; ++i)
+            tasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+
+        safeFree((void **) &deque->tasks);
+        deque->tasks = tasks;
+        deque->head = 0;
+        deque->capacity = newCapacity;
+    }
+
+    deque->tasks[(deque->head + deque->size) % deque->capacity] = task;
+    deque->size++;
+
+    pthread_mutex_unlock(&deque->lock);
+}
+
+/**
+ * Pobranie zadania z kolejki.
+ * @param[in,out] deque : kolejka
+ * @param[out] task : pobrane zadanie
+ * @param[in] back : czy pobrać z końca (właściciel) czy z początku
+ * (podkradanie)
+ * @return czy pobrano zadanie
+ * */
+static bool dequePop(Deque *deque, Task *task, bool back) {
+    pthread_mutex_lock(&deque->lock);
+
+    bool found = deque->size > 0;
+    if (found) {
+        if (back) {
+            *task = deque->tasks[(deque->head + deque->size - 1)
+                                 % deque->capacity];
+        }
+        else {
+            *task = deque->tasks[deque->head];
+            deque->head = (deque->head + 1) % deque->capacity;
+        }
+        deque->size--;
+    }
+
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+/**
+ * Znalezienie zadania do wykonania.
+ * Najpierw przeszukiwana jest własna kolejka, potem kolejki pozostałych
+ * wątków.
+ * @param[out] task : znalezione zadanie
+ * @return czy znaleziono zadanie
+ * */
+static bool findTask(Task *task) {
+    if (dequePop(&pool.deques[workerIdx], task, true))
+        return true;
+
+    for (size_t i = 1; i < pool.threads; ++i) {
+        size_t victim = (workerIdx + i) % pool.threads;
+        if (dequePop(&pool.deques[victim], task, false))
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * Wykonanie zadania.
+ * @param[in] task : zadanie
+ * */
+static void runTask(Task *task) {
+    atomic_fetch_sub(&pool.pending, 1);
+    task->fn(task->arg, task->idx);
+    atomic_fetch_sub(task->remaining, 1);
+}
+
+/**
+ * Pętla wątku roboczego.
+ * @param[in] arg : indeks kolejki wątku
+ * @return NULL
+ * */
+static void *workerLoop(void *arg) {
+    workerIdx = (size_t) arg;
+    Task task;
+
+    while (!atomic_load(&pool.stop)) {
+        if (findTask(&task)) {
+            runTask(&task);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool.idleLock);
+        while (atomic_load(&pool.pending) == 0 && !atomic_load(&pool.stop))
+            pthread_cond_wait(&pool.idleCond, &pool.idleLock);
+        pthread_mutex_unlock(&pool.idleLock);
+    }
+
+    return NULL;
+}
+
+size_t threadPoolMaxThreads(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return (cpus < 1 ? 1 : (size_t) cpus) * MAX_THREADS_PER_CPU;
+}
+
+void threadPoolInit(size_t threads) {
+    threadPoolDestroy();
+
+    if (threads > threadPoolMaxThreads())
+        threads = threadPoolMaxThreads();
+
+    if (threads <= 1)
+        return;
+
+    pool.threads = threads;
+    pool.deques = safeCalloc(threads, sizeof(Deque));
+    pool.workers = safeCalloc(threads - 1, sizeof(pthread_t));
+    atomic_store(&pool.stop, false);
+    atomic_store(&pool.pending, 0);
+    pthread_mutex_init(&pool.idleLock, NULL);
+    pthread_cond_init(&pool.idleCond, NULL);
+
+    for (size_t i = 0; i < threads; ++i)
+        pthread_mutex_init(&pool.deques[i].lock, NULL);
+
+    pool.started = 0;
+    while (pool.started + 1 < threads
+           && pthread_create(&pool.workers[pool.started], NULL, workerLoop,
+                             (void *) (pool.started + 1)) == 0)
+        pool.started++;
+
+    // Uruchomione wątki odczytują liczbę wątków, więc gdy nie udało się
+    // utworzyć wszystkich, pula tworzona jest od nowa z mniejszą liczbą.
+    if (pool.started + 1 < threads)
+        threadPoolInit(pool.started + 1);
+}
+
+void threadPoolDestroy(void) {
+    if (pool.threads <= 1)
+        return;
+
+    pthread_mutex_lock(&pool.idleLock);
+    atomic_store(&pool.stop, true);
+    pthread_cond_broadcast(&pool.idleCond);
+    pthread_mutex_unlock(&pool.idleLock);
+
+    for (size_t i = 0; i < pool.started; ++i)
+        pthread_join(pool.workers[i], NULL);
+
+    for (size_t i = 0; i < pool.threads; ++i) {
+        pthread_mutex_destroy(&pool.deques[i].lock);
+        safeFree((void **) &pool.deques[i].tasks);
+    }
+
+    pthread_mutex_destroy(&pool.idleLock);
+    pthread_cond_destroy(&pool.idleCond);
+    safeFree((void **) &pool.deques);
+    safeFree((void **) &pool.workers);
+    pool.started = 0;
+    pool.threads = 1;
+}
+
+size_t threadPoolThreads(void) {
+    return pool.threads;
+}
+
+void threadPoolFor(size_t count, void (*fn)(void *arg, size_t idx), void *arg) {
+    if (pool.threads <= 1 || count <= 1) {
+        for (size_t i = 0; i < count; ++i)
+            fn(arg, i);
+        return;
+    }
+
+    atomic_size_t remaining;
+    atomic_init(&remaining, count - 1);
+
+    // Zadania odkładane są od końca, więc właściciel pobiera je od początku.
+    for (size_t i = count - 1; i > 0; --i) {
+        Task task = {.fn = fn, .arg = arg, .idx = i, .remaining = &remaining};
+        dequePushBack(&pool.deques[workerIdx], task);
+        atomic_fetch_add(&pool.pending, 1);
+    }
+
+    pthread_mutex_lock(&pool.idleLock);
+    pthread_cond_broadcast(&pool.idleCond);
+    pthread_mutex_unlock(&pool.idleLock);
+
+    fn(arg, 0);
+
+    Task task;
+    while (atomic_load(&remaining) > 0) {
+        if (findTask(&task))
+            runTask(&task);
+        else
+            sched_yield();
+    }
+}
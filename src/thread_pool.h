@@ -0,0 +1,61 @@
+/** @file
+ * Interfejs puli wątków z podkradaniem zadań.
+ *
+ * Każdy wątek puli ma własną kolejkę dwustronną zadań. Wątek odkłada
+ * i pobiera zadania z końca swojej kolejki, a bezczynne wątki podkradają
+ * zadania z początku kolejek innych wątków. Wątek czekający na zakończenie
+ * swoich zadań sam wykonuje zadania oczekujące, więc zadania mogą
+ * bezpiecznie tworzyć kolejne zadania.
+ * */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h>
+
+/** Nazwa zmiennej środowiskowej z domyślną liczbą wątków. */
+#define THREADS_ENV_VARIABLE "POLY_THREADS"
+
+/** Największa liczba wątków puli przypadająca na jeden procesor. */
+#define MAX_THREADS_PER_CPU 4
+
+/**
+ * Największa sensowna liczba wątków puli.
+ * @return @ref MAX_THREADS_PER_CPU razy liczba dostępnych procesorów
+ * */
+size_t threadPoolMaxThreads(void);
+
+/**
+ * Uruchomienie puli wątków.
+ * Istniejąca pula jest wcześniej zatrzymywana. Wątek wywołujący jest
+ * jednym z wątków puli, więc dla @p threads równego 1 nie są tworzone
+ * żadne dodatkowe wątki. Gdy nie uda się utworzyć wszystkich wątków,
+ * pula ma ich tyle, ile udało się uruchomić. Liczba wątków ograniczana
+ * jest przez threadPoolMaxThreads().
+ * @param[in] threads : łączna liczba wątków, co najmniej 1
+ * */
+void threadPoolInit(size_t threads);
+
+/**
+ * Zatrzymanie puli wątków i zwolnienie jej zasobów.
+ * Po zatrzymaniu wszystkie zadania wykonywane są sekwencyjnie.
+ * */
+void threadPoolDestroy(void);
+
+/**
+ * Liczba wątków puli.
+ * @return łączna liczba wątków (1, gdy pula nie jest uruchomiona)
+ * */
+size_t threadPoolThreads(void);
+
+/**
+ * Równoległe wykonanie funkcji dla kolejnych indeksów.
+ * Wywołuje @p fn(@p arg, i) dla każdego @f$i < count@f$ i wraca po
+ * zakończeniu wszystkich wywołań. Kolejność wywołań nie jest określona.
+ * @param[in] count : liczba wywołań
+ * @param[in] fn : wykonywana funkcja
+ * @param[in,out] arg : argument przekazywany do funkcji
+ * */
+void threadPoolFor(size_t count, void (*fn)(void *arg, size_t idx), void *arg);
+
+#endif //THREAD_POOL_H